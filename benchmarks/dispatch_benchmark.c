@@ -0,0 +1,146 @@
+/**
+ * @file dispatch_benchmark.c
+ * @brief Benchmark do custo por token de encontrar a operação de um operador.
+ * @brief Compara a procura linear com strcmp (implementação antiga) com a tabela de dispatch de @file{operations_storage.c}.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "operations_storage.h"
+#include "operations.h"
+#include "conversions.h"
+#include "array_operations.h"
+#include "logica.h"
+#include "block_operations.h"
+#include "polymorphic_operations.h"
+
+/** Número de vezes que todos os operadores são procurados */
+#define ITERATIONS 1000000
+
+/**
+ * @brief Macro para criar uma operação simples (que recebe apenas a stack como parametro), o efeito na stack não é
+ * usado pelo benchmark
+ */
+#define SIMPLE_OPERATION(simple_operation_function) {SIMPLE_OPERATION, UNKNOWN_STACK_EFFECT, UNKNOWN_STACK_EFFECT, {.operation_function = simple_operation_function}}
+
+/**
+ * @brief Macro para criar uma operação com variáveis globais, o efeito na stack não é usado pelo benchmark
+ */
+#define VARIABLES_OPERATION(variables_operation_function) {VARIABLES_OPERATION, UNKNOWN_STACK_EFFECT, UNKNOWN_STACK_EFFECT, {.variables_operation = variables_operation_function}}
+
+/**
+ * @brief Struct para juntar o operador e a operação num só
+ */
+typedef struct {
+    /** @brief Operador string */
+    char operator[5];
+    /** @brief Operação */
+    StackOperation operation;
+} StackOperationTableEntry;
+
+/**
+ * @brief Tabela da implementação antiga, percorrida linearmente
+ */
+static const StackOperationTableEntry entries[] = {
+        {"+",  SIMPLE_OPERATION(add_operation)},
+        {"-",  SIMPLE_OPERATION(minus_operation)},
+        {"*",  VARIABLES_OPERATION(asterisk_operation)},
+        {"/",  SIMPLE_OPERATION(slash_symbol_operation)},
+        {"%",  VARIABLES_OPERATION(parentheses_symbol_operation)},
+        {"(",  SIMPLE_OPERATION(open_parentheses_operation)},
+        {")",  SIMPLE_OPERATION(close_parentheses_operation)},
+        {"#",  SIMPLE_OPERATION(hashtag_symbol_operation)},
+        {"&",  SIMPLE_OPERATION(and_bitwise_operation)},
+        {"|",  SIMPLE_OPERATION(or_bitwise_operation)},
+        {"^",  SIMPLE_OPERATION(xor_bitwise_operation)},
+        {"~",  VARIABLES_OPERATION(tilde_operation)},
+        {"_",  SIMPLE_OPERATION(duplicate_operation)},
+        {";",  SIMPLE_OPERATION(pop_operation)},
+        {"\\", SIMPLE_OPERATION(swap_last_two_operation)},
+        {"@",  SIMPLE_OPERATION(rotate_last_three_operation)},
+        {"$",  VARIABLES_OPERATION(dollar_symbol_operation)},
+        {"c",  SIMPLE_OPERATION(convert_last_element_to_char)},
+        {"i",  SIMPLE_OPERATION(convert_last_element_to_long)},
+        {"f",  SIMPLE_OPERATION(convert_last_element_to_double)},
+        {"l",  SIMPLE_OPERATION(read_input_from_console_operation)},
+        {"t",  SIMPLE_OPERATION(read_all_input_from_console_operation)},
+        {"s",  SIMPLE_OPERATION(convert_last_element_to_string)},
+        {">",  SIMPLE_OPERATION(bigger_than_symbol_operation)},
+        {"<",  SIMPLE_OPERATION(lesser_than_symbol_operation)},
+        {"=",  SIMPLE_OPERATION(equal_symbol_operation)},
+        {"e&", SIMPLE_OPERATION(and_operation)},
+        {"e|", SIMPLE_OPERATION(or_operation)},
+        {"e>", SIMPLE_OPERATION(lesser_value_operation)},
+        {"e<", SIMPLE_OPERATION(bigger_value_operation)},
+        {"?",  SIMPLE_OPERATION(if_then_else_operation)},
+        {"!",  SIMPLE_OPERATION(not_operation)},
+        {",",  VARIABLES_OPERATION(comma_symbol_operation)},
+        {"S/", SIMPLE_OPERATION(separate_string_by_whitespace_operation)},
+        {"N/", SIMPLE_OPERATION(separate_string_by_new_line_operation)},
+        {"w",  VARIABLES_OPERATION(while_top_truthy_operation)},
+        {"p",  SIMPLE_OPERATION(print_stack_top_operation)}
+};
+
+/** Número de entradas da tabela antiga */
+#define ENTRIES_COUNT (sizeof(entries) / sizeof(StackOperationTableEntry))
+
+/**
+ * @brief Procura linear da implementação antiga
+ * @param op operador
+ * @param to pointer para onde a operação encontrada irá ficar
+ * @return 1 se encontrou a operação, 0 caso contrário
+ */
+static int linear_find_operation(char op[], StackOperation *to) {
+    for (size_t i = 0; i < ENTRIES_COUNT; i++) {
+        if (strcmp(entries[i].operator, op) == 0) {
+            *to = entries[i].operation;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Tempo atual em nanosegundos
+ * @return O tempo
+ */
+static double now_nanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * @brief Mede o custo médio por token de uma função de procura
+ * @param name nome a mostrar
+ * @param find_function função de procura
+ */
+static void run_benchmark(const char *name, int (*find_function)(char[], StackOperation *)) {
+    char operators[ENTRIES_COUNT][5];
+    for (size_t i = 0; i < ENTRIES_COUNT; i++) {
+        strcpy(operators[i], entries[i].operator);
+    }
+
+    volatile long found = 0;
+    StackOperation operation;
+
+    double start = now_nanoseconds();
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        for (size_t i = 0; i < ENTRIES_COUNT; i++) {
+            found += find_function(operators[i], &operation);
+        }
+    }
+    double elapsed = now_nanoseconds() - start;
+
+    printf("%-8s %8.2f ns/token (%ld tokens)\n", name, elapsed / (double) found, (long) found);
+}
+
+/**
+ * @brief Corre o benchmark das duas implementações
+ */
+int main() {
+    run_benchmark("linear", linear_find_operation);
+    run_benchmark("table", find_operation);
+    return 0;
+}
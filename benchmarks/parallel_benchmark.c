@@ -0,0 +1,86 @@
+/**
+ * @file parallel_benchmark.c
+ * @brief Benchmark do map (%) e do filter (,) paralelos, simples e encaixados, com 1, 2, 4 e 8 threads, para medir
+ * a escalabilidade e o número de tarefas roubadas.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stack.h"
+#include "compiler.h"
+#include "executor.h"
+#include "block_operations.h"
+#include "thread_pool.h"
+#include "variable_operations.h"
+
+/** Número de elementos do array */
+#define ARRAY_LENGTH "1000000"
+
+/**
+ * @brief Tempo atual em nanosegundos
+ * @return O tempo
+ */
+static double now_nanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * @brief Mede um programa com um certo número de threads
+ * @param name nome do programa
+ * @param program_text o programa
+ * @param threads número de threads
+ */
+static void run_program_benchmark(const char *name, const char *program_text, int threads) {
+    char text[256];
+    snprintf(text, sizeof text, "%s", program_text);
+
+    set_thread_pool_size(threads);
+
+    Stack *stack = create_stack(16);
+    StackElement *variables = create_variable_array();
+    CompiledBlock *program = compile(text);
+
+    double start = now_nanoseconds();
+    execute_compiled_block(stack, variables, program);
+    double elapsed = now_nanoseconds() - start;
+
+    unsigned long steals = 0;
+    for (int worker = 0; worker < threads; worker++) {
+        steals += get_worker_stats(worker).steals;
+    }
+
+    printf("%-8s %d threads %10.2f ms %8lu steals\n", name, threads, elapsed / 1e6, steals);
+
+    free_stack(stack);
+    free(variables);
+    free_compiled_block(program);
+}
+
+/**
+ * @brief Corre os benchmarks
+ */
+int main() {
+    int thread_counts[] = {1, 2, 4, 8};
+
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        run_program_benchmark("map", "0 " ARRAY_LENGTH " , {_ _ * * 7 % 3 + 2 /} %", thread_counts[i]);
+    }
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        run_program_benchmark("filter", "0 " ARRAY_LENGTH " , {_ _ * * 7 % 3 <} ,", thread_counts[i]);
+    }
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        run_program_benchmark("fold", "0 " ARRAY_LENGTH " , {_ *} % {^} *", thread_counts[i]);
+    }
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        run_program_benchmark("nested", "0 2000 , {0 \\ 7 % 500 * , {3 %} , {+} *} %", thread_counts[i]);
+    }
+
+    free_thread_pool();
+    free_compiled_block_cache();
+    free_block_arena();
+    free_stack_pool();
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file sort_benchmark.c
+ * @brief Benchmark da ordenação de arrays ($) com e sem bloco para 10k, 100k e 1M elementos.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stack.h"
+#include "block_operations.h"
+#include "compiler.h"
+#include "variable_operations.h"
+
+/**
+ * @brief Tempo atual em nanosegundos
+ * @return O tempo
+ */
+static double now_nanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * @brief Mede a ordenação de um array de longs pseudo-aleatórios com um bloco
+ * @param array_length número de elementos
+ * @param block texto do bloco da chave
+ */
+static void run_sort_benchmark(int array_length, const char *block) {
+    Stack *stack = create_stack(2);
+    Stack *array = create_stack(array_length);
+    StackElement *variables = create_variable_array();
+
+    unsigned long seed = 12345;
+    for (int i = 0; i < array_length; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        push_long(array, (long) (seed >> 33));
+    }
+
+    push(stack, create_array_element(array));
+    push(stack, create_block_element(block));
+
+    double start = now_nanoseconds();
+    sort_block_array_operation(stack, variables);
+    double elapsed = now_nanoseconds() - start;
+
+    printf("%-8d {%-8s} %10.2f ms\n", array_length, block, elapsed / 1e6);
+
+    free_stack(stack);
+    free(variables);
+}
+
+/**
+ * @brief Mede a ordenação sem bloco de um array de strings pseudo-aleatórias
+ * @param array_length número de elementos
+ */
+static void run_string_sort_benchmark(int array_length) {
+    Stack *stack = create_stack(1);
+    Stack *array = create_stack(array_length);
+
+    unsigned long seed = 12345;
+    for (int i = 0; i < array_length; i++) {
+        char string[24];
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        int string_length = sprintf(string, "key%lu", seed >> 40);
+        push(array, create_string_element_with_length(string, (size_t) string_length));
+    }
+
+    push(stack, create_array_element(array));
+
+    double start = now_nanoseconds();
+    sort_array_operation(stack);
+    double elapsed = now_nanoseconds() - start;
+
+    printf("%-8d %-10s %10.2f ms\n", array_length, "strings", elapsed / 1e6);
+
+    free_stack(stack);
+}
+
+/**
+ * @brief Corre os benchmarks
+ */
+int main() {
+    int lengths[] = {10000, 100000, 1000000};
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        run_sort_benchmark(lengths[i], "");
+        run_sort_benchmark(lengths[i], "1000 %");
+        run_string_sort_benchmark(lengths[i]);
+    }
+
+    free_compiled_block_cache();
+    free_block_arena();
+    free_stack_pool();
+    return 0;
+}
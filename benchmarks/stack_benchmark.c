@@ -0,0 +1,123 @@
+/**
+ * @file stack_benchmark.c
+ * @brief Benchmark de aritmética sobre a stack (push, pop e operate_promoting_number_type).
+ * @brief Compilar com -DNAN_BOXING=ON e -DNAN_BOXING=OFF para comparar os valores NaN-boxed com os StackElements.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stack.h"
+#include "operations.h"
+#include "compiler.h"
+#include "executor.h"
+#include "variable_operations.h"
+
+/** Número de vezes que cada operação é repetida */
+#define ITERATIONS 10000000
+
+/** Número de iterações do programa */
+#define PROGRAM_ITERATIONS "1000000"
+
+/**
+ * @brief Tempo atual em nanosegundos
+ * @return O tempo
+ */
+static double now_nanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * @brief Mede pushes e pops de longs e doubles diretamente na stack
+ */
+static void run_push_pop_benchmark() {
+    Stack *stack = create_stack(16);
+    volatile long sum = 0;
+
+    double start = now_nanoseconds();
+    for (long i = 0; i < ITERATIONS; i++) {
+        push_long(stack, i);
+        push_double(stack, (double) i);
+        StackElement d = pop(stack);
+        StackElement l = pop(stack);
+        sum += l.content.long_value + (long) d.content.double_value;
+    }
+    double elapsed = now_nanoseconds() - start;
+
+    printf("%-12s %8.2f ns/op\n", "push/pop", elapsed / (ITERATIONS * 4.0));
+    free_stack(stack);
+}
+
+/**
+ * @brief Mede as operações aritméticas (+, *, -) sobre longs e doubles
+ */
+static void run_arithmetic_benchmark() {
+    Stack *stack = create_stack(16);
+    push_long(stack, 0);
+
+    double start = now_nanoseconds();
+    for (long i = 0; i < ITERATIONS; i++) {
+        push_long(stack, 3);
+        mult_operation(stack);
+        push_long(stack, i & 1023);
+        add_operation(stack);
+        push_long(stack, 1 << 20);
+        modulo_operation(stack);
+    }
+    double long_elapsed = now_nanoseconds() - start;
+
+    push_double(stack, 0.5);
+    add_operation(stack);
+
+    start = now_nanoseconds();
+    for (long i = 0; i < ITERATIONS; i++) {
+        push_double(stack, 1.5);
+        mult_operation(stack);
+        push_long(stack, 7);
+        minus_operation(stack);
+    }
+    double double_elapsed = now_nanoseconds() - start;
+
+    printf("%-12s %8.2f ns/op\n", "long ops", long_elapsed / (ITERATIONS * 3.0));
+    printf("%-12s %8.2f ns/op\n", "double ops", double_elapsed / (ITERATIONS * 2.0));
+    free_stack(stack);
+}
+
+/**
+ * @brief Mede um programa completo com um ciclo aritmético
+ */
+static void run_program_benchmark() {
+    char program_text[] = "0 " PROGRAM_ITERATIONS " { ( \\ 3 * 7 + 1000 % 2.5 * i \\ _ } w ;";
+
+    Stack *stack = create_stack(16);
+    StackElement *variables = create_variable_array();
+    CompiledBlock *program = compile(program_text);
+
+    double start = now_nanoseconds();
+    execute_compiled_block(stack, variables, program);
+    double elapsed = now_nanoseconds() - start;
+
+    printf("%-12s %8.2f ms\n", "program", elapsed / 1e6);
+
+    free_stack(stack);
+    free(variables);
+    free_compiled_block(program);
+    free_compiled_block_cache();
+}
+
+/**
+ * @brief Corre os benchmarks
+ */
+int main() {
+#ifdef NAN_BOXING
+    printf("storage: NaN-boxed (8 bytes)\n");
+#else
+    printf("storage: StackElement (%zu bytes)\n", sizeof(StackElement));
+#endif
+    run_push_pop_benchmark();
+    run_arithmetic_benchmark();
+    run_program_benchmark();
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file arena.c
+ * @brief Implementação do alocador por regiões
+ */
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/**
+ * Bloco de memória de uma arena, os blocos seguintes ficam ligados para serem reaproveitados
+ */
+struct arena_chunk {
+    /** Próximo bloco */
+    ArenaChunk *next;
+    /** Número de bytes de data */
+    size_t capacity;
+    /** Número de bytes usados de data */
+    size_t used;
+    /** Memória do bloco */
+    max_align_t data[];
+};
+
+/**
+ * Aloca um bloco de memória vazio
+ * @param capacity número de bytes
+ * @return O bloco
+ */
+static ArenaChunk *create_arena_chunk(size_t capacity) {
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + capacity);
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+Arena *create_arena(size_t chunk_size) {
+    Arena *arena = malloc(sizeof(Arena));
+    arena->first = create_arena_chunk(chunk_size);
+    arena->current = arena->first;
+    arena->chunk_size = chunk_size;
+
+    return arena;
+}
+
+void *arena_allocate(Arena *arena, size_t size) {
+    size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+    ArenaChunk *chunk = arena->current;
+
+    if (chunk->capacity - chunk->used < size) {
+        ArenaChunk *next = chunk->next;
+
+        if (next == NULL || next->capacity < size) {
+            next = create_arena_chunk(size > arena->chunk_size ? size : arena->chunk_size);
+            next->next = chunk->next;
+            chunk->next = next;
+        }
+
+        next->used = 0;
+        arena->current = chunk = next;
+    }
+
+    void *result = (char *) chunk->data + chunk->used;
+    chunk->used += size;
+
+    return result;
+}
+
+ArenaMark arena_mark(Arena *arena) {
+    ArenaMark mark = {arena->current, arena->current->used};
+    return mark;
+}
+
+void arena_release(Arena *arena, ArenaMark mark) {
+    arena->current = mark.chunk;
+    arena->current->used = mark.used;
+}
+
+void free_arena(Arena *arena) {
+    ArenaChunk *chunk = arena->first;
+
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    free(arena);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file arena.h
+ * @brief Alocador por regiões (arena) para memória temporária
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Bloco de memória de uma arena
+ */
+typedef struct arena_chunk ArenaChunk;
+
+/**
+ * Arena: a memória é alocada incrementando um pointer e é libertada toda de uma vez voltando a uma marca.
+ * Os blocos de memória nunca são devolvidos ao sistema antes de free_arena, para serem reutilizados.
+ */
+typedef struct {
+    /** Primeiro bloco de memória */
+    ArenaChunk *first;
+    /** Bloco onde são feitas as alocações */
+    ArenaChunk *current;
+    /** Tamanho mínimo de cada bloco de memória */
+    size_t chunk_size;
+} Arena;
+
+/**
+ * Posição de uma arena, para onde se pode voltar com arena_release
+ */
+typedef struct {
+    /** Bloco de memória atual no momento da marca */
+    ArenaChunk *chunk;
+    /** Bytes usados do bloco no momento da marca */
+    size_t used;
+} ArenaMark;
+
+/**
+ * Cria uma arena vazia
+ * @param chunk_size tamanho mínimo de cada bloco de memória
+ * @return A arena
+ */
+Arena *create_arena(size_t chunk_size);
+
+/**
+ * Aloca @param{size} bytes (alinhados para qualquer tipo) na arena
+ * @param arena target
+ * @param size número de bytes
+ * @return A memória alocada
+ */
+void *arena_allocate(Arena *arena, size_t size);
+
+/**
+ * @param arena target
+ * @return A posição atual da arena
+ */
+ArenaMark arena_mark(Arena *arena);
+
+/**
+ * Liberta tudo o que foi alocado na arena depois da marca
+ * @param arena target
+ * @param mark marca obtida com arena_mark
+ */
+void arena_release(Arena *arena, ArenaMark mark);
+
+/**
+ * Liberta toda a memória da arena
+ * @param arena target
+ */
+void free_arena(Arena *arena);
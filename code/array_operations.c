@@ -4,7 +4,6 @@
  */
 
 #include "array_operations.h"
-#include "parser.h"
 #include "logger.h"
 #include "stack.h"
 #include <string.h>
@@ -12,27 +11,6 @@
 /** Capacidade inicial de arrays */
 #define INITIAL_ARRAY_CAPACITY 5
 
-int parse_array(Stack *stack, StackElement *variables, char *word) {
-    size_t word_length = strlen(word);
-
-    if (*word != '[' || word[word_length - 1] != ']') {
-        return 0;
-    }
-
-    PRINT_DEBUG("Starting to parse array:\n")
-
-    // remover brackets:
-    word[word_length - 1] = '\0';
-    word++;
-
-    Stack *array = create_stack(INITIAL_ARRAY_CAPACITY);
-    tokenize_and_parse(array, variables, word);
-
-    push_array(stack, array);
-
-    return 1;
-}
-
 /**
  * @brief A Função devolve um array com o range de elementos de 0 a @param{range}
  * A Função recebe um valor @param{range} e devolve num array todos os elementos de 0 a @param{range}
@@ -40,7 +18,7 @@ int parse_array(Stack *stack, StackElement *variables, char *word) {
  * @param stack A Stack para onde vamos devolver o range do elemento
  */
 void create_range_array_operation(Stack *stack, long range) {
-    Stack *array = create_stack(INITIAL_ARRAY_CAPACITY);
+    Stack *array = create_stack(range > 0 ? (int) range : INITIAL_ARRAY_CAPACITY);
     for (int i = 0; i < range; i++) {
         push_long(array, (long) i);
     }
@@ -56,7 +34,7 @@ void size_range_operation(Stack *stack) {
     } else if (x_type == ARRAY_TYPE) {
         push_long(stack, (long) length(x.content.array_value));
     } else if (x_type == STRING_TYPE) {
-        push_long(stack, (long) strlen(x.content.string_value));
+        push_long(stack, (long) get_string_length(&x));
     }
 
     free_element(x);
@@ -66,36 +44,32 @@ void repeat_string_operation(Stack *stack) {
     long times = pop_long(stack);
     StackElement string_element = pop(stack);
 
-    char *from = string_element.content.string_value;
-    long from_length = (long) strlen(from);
+    char *from = get_string_value(&string_element);
+    long from_length = (long) get_string_length(&string_element);
 
-    char *dest = calloc((unsigned long) (from_length * times), sizeof(char));
+    StackElement result = allocate_string_element((unsigned long) (times > 0 ? from_length * times : 0));
+    char *dest = get_string_value(&result);
 
-    if (times > 0) {
-        int i;
-        for (i = 0; i < times - 1; ++i) {
-            memcpy(dest + i * from_length, from, (unsigned long) from_length);
-        }
-        memcpy(dest + i * from_length, from, (unsigned long) (from_length + 1));
+    for (long i = 0; i < times; ++i) {
+        memcpy(dest + i * from_length, from, (unsigned long) from_length);
     }
 
-    push_string(stack, dest);
+    push(stack, result);
 
     free_element(string_element);
-    free(dest);
 }
 
 void repeat_array_operation(Stack *stack) {
     long times = pop_long(stack) - 1;
     StackElement array_element = pop(stack);
 
-    Stack *array = array_element.content.array_value;
+    Stack *array = get_mutable_array(&array_element);
 
     long array_size = length(array);
 
     for (int i = 0; i < times; ++i) {
         for (int j = 0; j < array_size; ++j) {
-            push(array, duplicate_element(array->array[j]));
+            push(array, duplicate_element(get_element_at(array, j)));
         }
     }
 
@@ -110,7 +84,7 @@ void push_all_elements_from_array_operation(Stack *stack) {
     long array_size = length(array);
 
     for (int i = 0; i < array_size; ++i) {
-        push(stack, duplicate_element(array->array[i]));
+        push(stack, duplicate_element(get_element_at(array, i)));
     }
 
     free_element(element);
@@ -119,14 +93,28 @@ void push_all_elements_from_array_operation(Stack *stack) {
 /**
  * Procura a primeira ocorrencia da substring numa string e retorna o seu primeiro indice
  * @param string a string
+ * @param string_length tamanho da string
  * @param substring a substring
- * @return O indice da substring na string
+ * @param substring_length tamanho da substring
+ * @return O indice da substring na string, ou -1 caso não exista
  */
-static long get_index_substring(char *string, const char *substring) {
-    char *result = strstr(string, substring);
-    if (result == NULL) return -1;
+static long get_index_substring(const char *string, size_t string_length,
+                                const char *substring, size_t substring_length) {
+    if (substring_length == 0) return 0;
 
-    return result - string;
+    const char *current = string;
+    const char *end = string + string_length;
+
+    while ((size_t) (end - current) >= substring_length) {
+        current = memchr(current, substring[0], (size_t) (end - current) - substring_length + 1);
+        if (current == NULL) return -1;
+
+        if (memcmp(current, substring, substring_length) == 0) return current - string;
+
+        current++;
+    }
+
+    return -1;
 }
 
 /**
@@ -135,31 +123,32 @@ static long get_index_substring(char *string, const char *substring) {
  * e dar push aos mesmos para a stack 
  * @param stack A stack para onde vamos dar push aos chars que surgem da separação @param{string}
  * @param string A string que vamos separar em chars
+ * @param string_length tamanho da string
  */
-static void split_string_char_by_char(Stack *stack, char *string) {
-    while (*string != 0) {
-        char *temp_string = strdup(string);
-        temp_string[1] = '\0';
-
-        push_string(stack, temp_string);
-
-        free(temp_string);
-
-        string++;
+static void split_string_char_by_char(Stack *stack, const char *string, size_t string_length) {
+    for (size_t i = 0; i < string_length; i++) {
+        push(stack, create_string_element_with_length(string + i, 1));
     }
 }
 
 /**
- * @brief Divide uma string em strings através de mais que um delimitador 
+ * @brief Divide uma string em strings através de mais que um delimitador, ignorando as strings vazias
  * @param stack receiver
  * @param string target
+ * @param string_length tamanho da string
  * @param delimiters delimitador
  */
-static void split_string_by_multiple_delimiters(Stack *stack, char *string, const char *delimiters) {
-    string = strtok(string, delimiters);
-    while (string != NULL) {
-        push_string(stack, string);
-        string = strtok(NULL, delimiters);
+static void split_string_by_multiple_delimiters(Stack *stack, const char *string, size_t string_length,
+                                                const char *delimiters) {
+    size_t token_start = 0;
+
+    for (size_t i = 0; i <= string_length; i++) {
+        if (i < string_length && (string[i] == '\0' || strchr(delimiters, string[i]) == NULL)) continue;
+
+        if (i > token_start) {
+            push(stack, create_string_element_with_length(string + token_start, i - token_start));
+        }
+        token_start = i + 1;
     }
 }
 
@@ -167,22 +156,22 @@ static void split_string_by_multiple_delimiters(Stack *stack, char *string, cons
  * @brief Divide uma string em duas strings usando uma substring
  * @param stack receiver
  * @param string target
+ * @param string_length tamanho da string
  * @param delimiters substring
+ * @param delimiters_length tamanho da substring
  */
-static void split_string_by_substring(Stack *stack, char *string, const char *delimiters) {
-    long substring_length = (long) strlen(delimiters);
-
+static void split_string_by_substring(Stack *stack, const char *string, size_t string_length,
+                                      const char *delimiters, size_t delimiters_length) {
     long current_index;
-    while ((current_index = get_index_substring(string, delimiters)) != -1) {
-        string[current_index] = '\0';
-        push_string(stack, string);
+    while ((current_index = get_index_substring(string, string_length, delimiters, delimiters_length)) != -1) {
+        push(stack, create_string_element_with_length(string, (size_t) current_index));
 
-        string += current_index + substring_length;
+        string += (size_t) current_index + delimiters_length;
+        string_length -= (size_t) current_index + delimiters_length;
     }
 
-    if (*string) {
-        string[current_index] = '\0';
-        push_string(stack, string);
+    if (string_length > 0) {
+        push(stack, create_string_element_with_length(string, string_length));
     }
 }
 
@@ -190,20 +179,23 @@ static void split_string_by_substring(Stack *stack, char *string, const char *de
  * @brief Separa uma string em string dependendo de o número de delimitadores
  * @param stack target
  * @param substring_string string
+ * @param substring_length tamanho da string
  * @param multiple_delimiters número de delimitadores
  */
-void separate_string_by_substring(Stack *stack, const char *substring_string, int multiple_delimiters) {
+void separate_string_by_substring(Stack *stack, const char *substring_string, size_t substring_length,
+                                  int multiple_delimiters) {
     StackElement target_element = pop(stack);
-    char *target_string = target_element.content.string_value;
+    const char *target_string = get_string_value(&target_element);
+    size_t target_length = get_string_length(&target_element);
 
     Stack *result_array = create_stack(INITIAL_ARRAY_CAPACITY);
 
     if (multiple_delimiters) {
-        split_string_by_multiple_delimiters(result_array, target_string, substring_string);
-    } else if (*substring_string) {
-        split_string_by_substring(result_array, target_string, substring_string);
+        split_string_by_multiple_delimiters(result_array, target_string, target_length, substring_string);
+    } else if (substring_length > 0) {
+        split_string_by_substring(result_array, target_string, target_length, substring_string, substring_length);
     } else {
-        split_string_char_by_char(result_array, target_string);
+        split_string_char_by_char(result_array, target_string, target_length);
     }
 
     push_array(stack, result_array);
@@ -213,17 +205,17 @@ void separate_string_by_substring(Stack *stack, const char *substring_string, in
 void separate_string_by_substring_operation(Stack *stack) {
     StackElement substring_element = pop(stack);
 
-    separate_string_by_substring(stack, substring_element.content.string_value, 0);
+    separate_string_by_substring(stack, get_string_value(&substring_element), get_string_length(&substring_element), 0);
 
     free_element(substring_element);
 }
 
 void separate_string_by_new_line_operation(Stack *stack) {
-    separate_string_by_substring(stack, "\n", 0);
+    separate_string_by_substring(stack, "\n", 1, 0);
 }
 
 void separate_string_by_whitespace_operation(Stack *stack) {
-    separate_string_by_substring(stack, " \n\t\v\f\r", 1);
+    separate_string_by_substring(stack, " \n\t\v\f\r", 6, 1);
 }
 
 /**
@@ -241,14 +233,9 @@ void take_first_n_elements_from_array_operation(Stack *stack) {
     StackElement array_element = pop(stack);
     Stack *array = array_element.content.array_value;
 
-    Stack *new_array = create_stack(number_of_elements);
     int new_array_length = min(number_of_elements, length(array));
 
-    for (int i = 0; i < new_array_length; i++) {
-        push(new_array, duplicate_element(array->array[i]));
-    }
-
-    push(stack, create_array_element(new_array));
+    push(stack, create_array_element(copy_stack_range(array, 0, new_array_length)));
 
     free_element(array_element);
 }
@@ -257,12 +244,13 @@ void take_first_n_elements_from_string_operation(Stack *stack) {
     long number_of_elements = pop_long(stack);
     StackElement string_element = pop(stack);
 
-    char *string_value = string_element.content.string_value;
-    int new_string_length = (int) strnlen(string_value, (size_t) number_of_elements);
-
-    string_value[new_string_length] = '\0';
+    char *string_value = get_string_value(&string_element);
+    size_t string_length = get_string_length(&string_element);
+    size_t new_string_length = number_of_elements >= 0 && (size_t) number_of_elements < string_length
+                               ? (size_t) number_of_elements
+                               : string_length;
 
-    push_string(stack, string_value);
+    push(stack, create_string_element_with_length(string_value, new_string_length));
 
     free_element(string_element);
 }
@@ -274,13 +262,10 @@ void take_last_n_elements_from_array_operation(Stack *stack) {
     Stack *old_array = element.content.array_value;
     int old_array_length = length(old_array);
 
-    Stack *new_array = create_stack((int) number_of_elements);
+    int new_array_length = number_of_elements > 0 ? min((int) number_of_elements, old_array_length) : 0;
 
-    for (long int i = old_array_length - number_of_elements; i < old_array_length; i++) {
-        push(new_array, duplicate_element(old_array->array[i]));
-    }
-
-    push(stack, create_array_element(new_array));
+    push(stack, create_array_element(
+            copy_stack_range(old_array, old_array_length - new_array_length, new_array_length)));
 
     free_element(element);
 }
@@ -289,16 +274,17 @@ void take_last_n_elements_from_string_operation(Stack *stack) {
     long number_of_elements = pop_long(stack);
     StackElement element = pop(stack);
 
-    char *string = element.content.string_value;
-    size_t string_length = strlen(string);
+    char *string = get_string_value(&element);
+    size_t string_length = get_string_length(&element);
 
     long string_offset = (long) string_length - number_of_elements;
 
     if (number_of_elements > 0 && string_offset > 0) {
         string += string_offset;
+        string_length -= (size_t) string_offset;
     }
 
-    push_string(stack, string);
+    push(stack, create_string_element_with_length(string, string_length));
 
     free_element(element);
 }
@@ -307,7 +293,7 @@ void get_element_from_index_array_operation(Stack *stack) {
     long index = pop_long(stack);
     StackElement array_element = pop(stack);
 
-    StackElement element_from_index = array_element.content.array_value->array[index];
+    StackElement element_from_index = get_element_at(array_element.content.array_value, (int) index);
     push(stack, duplicate_element(element_from_index));
 
     free_element(array_element);
@@ -317,7 +303,7 @@ void get_element_from_index_string_operation(Stack *stack) {
     long index = pop_long(stack);
     StackElement string_element = pop(stack);
 
-    char char_from_index = string_element.content.string_value[index];
+    char char_from_index = get_string_value(&string_element)[index];
     push_char(stack, char_from_index);
 
     free_element(string_element);
@@ -327,27 +313,26 @@ void remove_first_element_from_array_operation(Stack *stack) {
     StackElement element = pop(stack);
     Stack *old_array = element.content.array_value;
 
-    Stack *new_array = create_stack(length(old_array) - 1);
-
-    StackElement first_element = old_array->array[0];
-    for (int i = 1; i < length(old_array); i++) {
-        push(new_array, old_array->array[i]);
-    }
+    StackElement first_element = duplicate_element(get_element_at(old_array, 0));
+    Stack *new_array = copy_stack_range(old_array, 1, length(old_array) - 1);
 
     push_array(stack, new_array);
     push(stack, first_element);
+
+    free_element(element);
 }
 
 void remove_first_element_from_string_operation(Stack *stack) {
     StackElement element = pop(stack);
 
-    char *string_value = element.content.string_value;
+    char *string_value = get_string_value(&element);
+    size_t string_length = get_string_length(&element);
 
-    char first_char = string_value[0];
+    if (string_length <= 0) PANIC("Trying to remove first char from empty string")
 
-    string_value++;
+    char first_char = string_value[0];
 
-    push_string(stack, string_value);
+    push(stack, create_string_element_with_length(string_value + 1, string_length - 1));
     push_char(stack, first_char);
 
     free_element(element);
@@ -355,7 +340,7 @@ void remove_first_element_from_string_operation(Stack *stack) {
 
 void remove_last_element_from_array_operation(Stack *stack) {
     StackElement element = pop(stack);
-    StackElement last_element = pop(element.content.array_value);
+    StackElement last_element = pop(get_mutable_array(&element));
 
     push(stack, element);
     push(stack, last_element);
@@ -364,53 +349,41 @@ void remove_last_element_from_array_operation(Stack *stack) {
 void remove_last_element_from_string_operation(Stack *stack) {
     StackElement element = pop(stack);
 
-    char *string_value = element.content.string_value;
-    size_t string_length = strlen(string_value);
+    char *string_value = get_string_value(&element);
+    size_t string_length = get_string_length(&element);
 
     if (string_length <= 0) PANIC("Trying to remove last char from empty string")
 
     char last_element = string_value[string_length - 1];
-    string_value[string_length - 1] = '\0';
 
-    push_string(stack, string_value);
+    push(stack, create_string_element_with_length(string_value, string_length - 1));
     push_char(stack, last_element);
 
     free_element(element);
 }
 
-/**
-* @brief A função transforma um elemento do tipo char ou string em string
-* @param element target
-*/
-char *consume_and_get_string_value(StackElement element) {
-    char *result;
-    if (element.type == STRING_TYPE) {
-        result = strdup(element.content.string_value);
-    } else if (element.type == CHAR_TYPE) {
-        result = calloc(2, sizeof(char));
-
-        result[0] = element.content.char_value;
-        result[1] = '\0';
-    } else {
-        PANIC("Couldn't get string value from stack element type=%d", element.type)
-    }
-
-    free_element(element);
-
-    return result;
-}
-
 void search_substring_in_string_operation(Stack *stack) {
     StackElement substring_element = pop(stack);
     StackElement string_element = pop(stack);
 
-    char *string_value = string_element.content.string_value;
-    char *substring_string = consume_and_get_string_value(substring_element);
+    const char *substring_string;
+    size_t substring_length;
 
-    long index = get_index_substring(string_value, substring_string);
+    if (substring_element.type == STRING_TYPE) {
+        substring_string = get_string_value(&substring_element);
+        substring_length = get_string_length(&substring_element);
+    } else if (substring_element.type == CHAR_TYPE) {
+        substring_string = &substring_element.content.char_value;
+        substring_length = 1;
+    } else {
+        PANIC("Couldn't get string value from stack element type=%d", substring_element.type)
+    }
+
+    long index = get_index_substring(get_string_value(&string_element), get_string_length(&string_element),
+                                     substring_string, substring_length);
 
     push_long(stack, index);
 
     free_element(string_element);
-    free(substring_string);
+    free_element(substring_element);
 }
@@ -7,12 +7,6 @@
 
 #include "stack.h"
 
-/**
-* @brief Dá parse a um array e da push a este para a stack
-* @param stack target
-*/
-int parse_array(Stack *stack, StackElement *variables, char *word);
-
 /**
 * @brief Devolve o tamanho de um array/string ou então devolve um array com o range até este valor caso seja long
 * @param stack target
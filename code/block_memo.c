@@ -0,0 +1,177 @@
+/**
+ * @file block_memo.c
+ * @brief Implementação da memoização dos resultados de blocos puros
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "block_memo.h"
+#include "variable_operations.h"
+
+/** Número de entradas da tabela de memoização de cada thread (potência de 2) */
+#define BLOCK_MEMO_SIZE 2048
+
+/** Número máximo de elementos de um resultado guardado */
+#define BLOCK_MEMO_MAX_RESULTS 2
+
+/**
+ * Entrada da tabela de memoização
+ */
+typedef struct {
+    /** Bloco compilado (NULL se a entrada está vazia) */
+    CompiledBlock *block;
+    /** Variáveis globais com que o bloco foi executado */
+    StackElement *variables;
+    /** Versão das variáveis com que o bloco foi executado */
+    unsigned long variables_version;
+    /** Elemento a que o bloco foi aplicado (ver get_canonical_key) */
+    StackElement key;
+    /** Número de elementos do resultado */
+    int result_length;
+    /** Elementos do resultado (sem contadores de referências) */
+    StackElement results[BLOCK_MEMO_MAX_RESULTS];
+} BlockMemoEntry;
+
+/**
+ * Tabela de memoização da thread (alocada no primeiro resultado guardado)
+ */
+static _Thread_local BlockMemoEntry *block_memo = NULL;
+
+/**
+ * Contadores da thread
+ */
+static _Thread_local BlockMemoStats block_memo_stats;
+
+/**
+ * Contadores das threads que já libertaram a sua tabela
+ */
+static BlockMemoStats total_block_memo_stats;
+
+int is_block_memo_key(StackElement element) {
+    switch (element.type) {
+        case LONG_TYPE:
+        case DOUBLE_TYPE:
+        case CHAR_TYPE:
+            return 1;
+        case STRING_TYPE:
+            return element.short_string.length != LONG_STRING_MARKER;
+        case ARRAY_TYPE:
+        case BLOCK_TYPE:
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Copia o valor de uma chave para um elemento com todos os outros bytes a zero, para as chaves poderem ser
+ * comparadas e dispersas byte a byte (os doubles são comparados pelos bits)
+ * @param key elemento (ver is_block_memo_key)
+ * @return A chave canónica
+ */
+static StackElement get_canonical_key(StackElement key) {
+    StackElement canonical;
+    memset(&canonical, 0, sizeof(canonical));
+
+    if (key.type == STRING_TYPE) {
+        canonical.short_string.type = STRING_TYPE;
+        canonical.short_string.length = key.short_string.length;
+        memcpy(canonical.short_string.value, key.short_string.value, key.short_string.length);
+    } else {
+        canonical.type = key.type;
+        if (key.type == CHAR_TYPE) {
+            canonical.content.char_value = key.content.char_value;
+        } else {
+            canonical.content = key.content;
+        }
+    }
+
+    return canonical;
+}
+
+/**
+ * @brief Retorna a entrada da tabela onde fica o resultado de um bloco aplicado a uma chave
+ * @param block bloco compilado
+ * @param key chave canónica
+ * @return A entrada
+ */
+static BlockMemoEntry *get_block_memo_entry(CompiledBlock *block, StackElement *key) {
+    uint64_t words[sizeof(StackElement) / sizeof(uint64_t)];
+    memcpy(words, key, sizeof(words));
+
+    uint64_t hash = (uint64_t) (uintptr_t) block;
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15u;
+    }
+
+    return &block_memo[(hash >> 32) & (BLOCK_MEMO_SIZE - 1)];
+}
+
+int find_block_memo(CompiledBlock *block, StackElement *variables, StackElement key, Stack *result) {
+    if (block_memo == NULL) {
+        block_memo_stats.misses++;
+        return 0;
+    }
+
+    StackElement canonical = get_canonical_key(key);
+    BlockMemoEntry *entry = get_block_memo_entry(block, &canonical);
+
+    if (entry->block != block || entry->variables != variables
+        || entry->variables_version != get_variables_version()
+        || memcmp(&entry->key, &canonical, sizeof(StackElement)) != 0) {
+        block_memo_stats.misses++;
+        return 0;
+    }
+
+    for (int i = 0; i < entry->result_length; i++) {
+        push(result, entry->results[i]);
+    }
+
+    block_memo_stats.hits++;
+    return 1;
+}
+
+int save_block_memo(CompiledBlock *block, StackElement *variables, StackElement key, Stack *result) {
+    int result_length = length(result);
+    if (result_length > BLOCK_MEMO_MAX_RESULTS) return 0;
+
+    StackElement results[BLOCK_MEMO_MAX_RESULTS];
+    for (int i = 0; i < result_length; i++) {
+        results[i] = get_element_at(result, i);
+        if (needs_reference_count(&results[i])) return 0;
+    }
+
+    if (block_memo == NULL) block_memo = calloc(BLOCK_MEMO_SIZE, sizeof(BlockMemoEntry));
+
+    StackElement canonical = get_canonical_key(key);
+    BlockMemoEntry *entry = get_block_memo_entry(block, &canonical);
+
+    if (entry->block != NULL) block_memo_stats.evictions++;
+
+    entry->block = block;
+    entry->variables = variables;
+    entry->variables_version = get_variables_version();
+    entry->key = canonical;
+    entry->result_length = result_length;
+    memcpy(entry->results, results, (size_t) result_length * sizeof(StackElement));
+    return 1;
+}
+
+BlockMemoStats get_block_memo_stats(void) {
+    BlockMemoStats stats = {
+            __atomic_load_n(&total_block_memo_stats.hits, __ATOMIC_RELAXED) + block_memo_stats.hits,
+            __atomic_load_n(&total_block_memo_stats.misses, __ATOMIC_RELAXED) + block_memo_stats.misses,
+            __atomic_load_n(&total_block_memo_stats.evictions, __ATOMIC_RELAXED) + block_memo_stats.evictions
+    };
+
+    return stats;
+}
+
+void free_block_memo(void) {
+    __atomic_fetch_add(&total_block_memo_stats.hits, block_memo_stats.hits, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total_block_memo_stats.misses, block_memo_stats.misses, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total_block_memo_stats.evictions, block_memo_stats.evictions, __ATOMIC_RELAXED);
+    memset(&block_memo_stats, 0, sizeof(block_memo_stats));
+
+    free(block_memo);
+    block_memo = NULL;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file block_memo.h
+ * @brief Memoização dos resultados de blocos puros: uma tabela de tamanho fixo (por thread) indexada pelo bloco
+ * compilado e pelo valor do elemento a que o bloco é aplicado.
+ */
+
+#pragma once
+
+#include "stack.h"
+#include "compiler.h"
+
+/**
+ * Contadores da memoização
+ */
+typedef struct {
+    /** Número de procuras que encontraram o resultado */
+    unsigned long hits;
+    /** Número de procuras que não encontraram o resultado */
+    unsigned long misses;
+    /** Número de resultados substituídos por outros na tabela */
+    unsigned long evictions;
+} BlockMemoStats;
+
+/**
+ * Verifica se um elemento pode ser usado como chave da memoização (longs, doubles, chars e strings curtas)
+ * @param element elemento
+ * @return 1 se pode ser chave, 0 caso contrário
+ */
+int is_block_memo_key(StackElement element);
+
+/**
+ * Procura o resultado de um bloco aplicado a um elemento.
+ * Os resultados deixam de ser encontrados quando alguma variável é alterada.
+ * @param block bloco compilado (puro, ver is_thread_safe_block)
+ * @param variables variáveis globais
+ * @param key elemento (ver is_block_memo_key)
+ * @param result stack onde fazer push dos elementos resultado
+ * @return 1 se o resultado foi encontrado, 0 caso contrário
+ */
+int find_block_memo(CompiledBlock *block, StackElement *variables, StackElement key, Stack *result);
+
+/**
+ * Guarda o resultado de um bloco aplicado a um elemento, substituindo o resultado que ocupava a mesma posição da
+ * tabela. Só são guardados resultados pequenos sem contadores de referências.
+ * @param block bloco compilado (puro, ver is_thread_safe_block)
+ * @param variables variáveis globais
+ * @param key elemento (ver is_block_memo_key)
+ * @param result stack resultado do bloco
+ * @return 1 se o resultado foi guardado, 0 se não pode ser guardado
+ */
+int save_block_memo(CompiledBlock *block, StackElement *variables, StackElement key, Stack *result);
+
+/**
+ * Retorna os contadores da memoização de todas as threads que já libertaram a sua tabela e da thread atual
+ * @return Os contadores
+ */
+BlockMemoStats get_block_memo_stats(void);
+
+/**
+ * Liberta a tabela de memoização da thread atual (e junta os seus contadores aos totais)
+ */
+void free_block_memo(void);
@@ -6,25 +6,17 @@
 #include <string.h>
 #include "block_operations.h"
 #include "logger.h"
-#include "parser.h"
+#include "compiler.h"
+#include "executor.h"
 #include "conversions.h"
 #include "operations.h"
-
-int try_to_parse_block(Stack *stack, char *word) {
-    size_t word_length = strlen(word);
-
-    if (*word != '{' || word[word_length - 1] != '}') {
-        return 0;
-    }
-
-    // remover brackets:
-    word[word_length - 1] = '\0';
-    word++;
-
-    push_block(stack, word);
-
-    return 1;
-}
+#include "string_operations.h"
+#include "sorting.h"
+#include "thread_pool.h"
+#include "reductions.h"
+#include "block_memo.h"
+#include "logica.h"
+#include "polymorphic_operations.h"
 
 /**
 * @brief Executa um bloco na stack
@@ -36,49 +28,357 @@ void execute_block_stack(Stack *stack, StackElement block_element, StackElement
     if (block_element.type != BLOCK_TYPE) PANIC("Trying to execute a non-block element type (%d).", block_element.type)
 
     PRINT_DEBUG("Starting to execute block {%s}:\n", block_element.content.block_value)
-    tokenize_and_parse(stack, variables, block_element.content.block_value);
+    execute_compiled_block(stack, variables, get_compiled_block(block_element.content.block_value));
+}
+
+/**
+ * Tamanho de cada bloco de memória da arena das invocações de blocos
+ */
+#define BLOCK_ARENA_CHUNK_SIZE 4096
+
+/**
+ * Arena onde são alocadas as stacks temporárias das invocações de blocos.
+ * As invocações são sempre encaixadas umas dentro das outras, por isso cada operação guarda uma marca
+ * e volta a ela depois de cada invocação. Cada thread tem a sua arena.
+ */
+static _Thread_local Arena *block_arena = NULL;
+
+/**
+ * @brief Marca o início de uma sequência de invocações de blocos
+ * @return A marca para onde voltar com end_block_invocation
+ */
+static ArenaMark begin_block_invocations(void) {
+    if (block_arena == NULL) block_arena = create_arena(BLOCK_ARENA_CHUNK_SIZE);
+
+    return arena_mark(block_arena);
+}
+
+/**
+ * @brief Liberta os elementos que sobraram na stack resultado de uma invocação e a memória temporária da invocação
+ * @param result_stack stack retornada por execute_block
+ * @param mark marca obtida com begin_block_invocations
+ */
+static void end_block_invocation(Stack *result_stack, ArenaMark mark) {
+    free_stack(result_stack);
+    arena_release(block_arena, mark);
 }
 
 Stack *execute_block(StackElement target_element, StackElement block_element, StackElement *variables) {
-    Stack *result_stack = create_stack(10);
+    if (block_arena == NULL) block_arena = create_arena(BLOCK_ARENA_CHUNK_SIZE);
+
+    Stack *result_stack = create_stack_in_arena(block_arena, 10);
     push(result_stack, duplicate_element(target_element));
 
     execute_block_stack(result_stack, block_element, variables);
     return result_stack;
 }
 
+/**
+ * Número mínimo de elementos para os resultados de um bloco serem memoizados
+ */
+#define BLOCK_MEMO_MIN_LENGTH 32
+
+/**
+ * Número mínimo de instruções (incluindo a RETURN_INSTRUCTION) de um bloco memoizado, os blocos mais curtos são
+ * mais rápidos de executar do que de procurar
+ */
+#define BLOCK_MEMO_MIN_INSTRUCTIONS 5
+
+/**
+ * Número de procuras na memoização depois das quais ela é desligada se tiver poucos hits
+ */
+#define BLOCK_MEMO_PROBE_LOOKUPS 256
+
+/**
+ * A memoização continua ligada se pelo menos uma em cada BLOCK_MEMO_MIN_HIT_RATIO procuras encontrar o resultado
+ */
+#define BLOCK_MEMO_MIN_HIT_RATIO 4
+
+/**
+ * Memoização de um bloco durante as invocações sobre os elementos de um array
+ */
+typedef struct {
+    /** Bloco compilado, NULL se os resultados não são memoizados */
+    CompiledBlock *block;
+    /** Número de procuras */
+    int lookups;
+    /** Número de procuras que encontraram o resultado */
+    int hits;
+} BlockMemo;
+
+/**
+* @brief Prepara a memoização de um bloco aplicado a vários elementos: só os blocos puros (ver is_thread_safe_block)
+* com pelo menos BLOCK_MEMO_MIN_INSTRUCTIONS instruções aplicados a pelo menos BLOCK_MEMO_MIN_LENGTH elementos são
+* memoizados
+* @param memo target
+* @param block_element bloco
+* @param variables value of variables
+* @param element_count número de elementos
+*/
+static void start_block_memo(BlockMemo *memo, StackElement block_element, StackElement *variables,
+                             int element_count) {
+    memo->block = NULL;
+    memo->lookups = 0;
+    memo->hits = 0;
+
+#ifdef BLOCK_MEMO
+    if (element_count < BLOCK_MEMO_MIN_LENGTH) return;
+
+    CompiledBlock *block = get_compiled_block(block_element.content.block_value);
+    if (block->length >= BLOCK_MEMO_MIN_INSTRUCTIONS && is_thread_safe_block(block_element, variables)) {
+        memo->block = block;
+    }
+#else
+    (void) block_element;
+    (void) variables;
+    (void) element_count;
+#endif
+}
+
+/**
+* @brief Executa um bloco sobre um elemento como execute_block, reutilizando o resultado memoizado quando o elemento
+* já apareceu. A memoização é desligada quando tem poucos hits (elementos quase todos diferentes) ou quando os
+* resultados não podem ser guardados.
+* @param memo memoização preparada com start_block_memo
+* @param target_element elemento
+* @param block_element bloco
+* @param variables value of variables
+* @return A stack resultado
+*/
+static Stack *execute_memoized_block(BlockMemo *memo, StackElement target_element, StackElement block_element,
+                                     StackElement *variables) {
+    if (memo->block == NULL || !is_block_memo_key(target_element)) {
+        return execute_block(target_element, block_element, variables);
+    }
+
+    Stack *result_stack = create_stack_in_arena(block_arena, 10);
+    memo->lookups++;
+
+    if (find_block_memo(memo->block, variables, target_element, result_stack)) {
+        memo->hits++;
+        return result_stack;
+    }
+
+    if (memo->lookups >= BLOCK_MEMO_PROBE_LOOKUPS && memo->hits * BLOCK_MEMO_MIN_HIT_RATIO < memo->lookups) {
+        memo->block = NULL;
+    }
+
+    push(result_stack, duplicate_element(target_element));
+    execute_block_stack(result_stack, block_element, variables);
+
+    if (memo->block != NULL && !save_block_memo(memo->block, variables, target_element, result_stack)) {
+        memo->block = NULL;
+    }
+    return result_stack;
+}
+
+void free_block_arena(void) {
+    if (block_arena == NULL) return;
+
+    free_arena(block_arena);
+    block_arena = NULL;
+}
+
 void execute_block_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement target_element = pop(stack);
 
+    ArenaMark mark = begin_block_invocations();
+
     Stack *result_stack = execute_block(target_element, block_element, variables);
-    push_all(stack, result_stack);
+    move_all(stack, result_stack);
 
-    free_stack(result_stack);
+    end_block_invocation(result_stack, mark);
+    free_element(target_element);
+    free_element(block_element);
 }
 
 /**
-* @brief Aplica o bloco a todos os elementos deste
-* @param stack target
+ * Número mínimo de elementos de um array para o map e o filter serem executados em paralelo
+ */
+#define PARALLEL_MIN_LENGTH 256
+
+/**
+ * Número de partes de um map ou filter paralelo por thread (as partes são roubadas pelas threads sem trabalho)
+ */
+#define PARALLEL_PARTS_PER_THREAD 8
+
+/**
+ * Número mínimo de elementos de cada parte de um map ou filter paralelo
+ */
+#define PARALLEL_MIN_GRAIN 16
+
+/**
+ * Número máximo de elementos de cada parte de um map ou filter paralelo
+ */
+#define PARALLEL_MAX_GRAIN 1024
+
+/**
+ * Função que aplica um bloco aos elementos [start, end[ de um array e guarda os resultados numa stack
+ */
+typedef void (*BlockRangeFunction)(Stack *result, Stack *array, int start, int end, StackElement block_element,
+                                   StackElement *variables);
+
+/**
+ * Argumentos de um map ou filter paralelo
+ */
+typedef struct {
+    /** Função a aplicar a cada parte */
+    BlockRangeFunction function;
+    /** Array target */
+    Stack *array;
+    /** Bloco a executar */
+    StackElement block_element;
+    /** Variáveis globais */
+    StackElement *variables;
+    /** Número de elementos de cada parte */
+    int grain;
+    /** Resultado de cada parte, pela ordem das partes */
+    Stack **results;
+} ParallelBlockJob;
+
+/**
+* @brief Aplica o bloco aos elementos [start, end[ de um array e faz push dos resultados
+* @param result stack onde ficam os resultados
+* @param array target
+* @param start primeiro elemento
+* @param end elemento a seguir ao último
 * @param block_element block to execute
 * @param variables value of variables
 */
-Stack *map_blocks(Stack *array, StackElement block_element, StackElement *variables) {
-    int array_target_length = length(array);
-    Stack *array_result = create_stack(array_target_length);
+static void map_blocks_range(Stack *result, Stack *array, int start, int end, StackElement block_element,
+                             StackElement *variables) {
+    ArenaMark mark = begin_block_invocations();
+    BlockMemo memo;
+    start_block_memo(&memo, block_element, variables, end - start);
+
+    for (int i = start; i < end; ++i) {
+        Stack *block_result = execute_memoized_block(&memo, get_element_at(array, i), block_element, variables);
+
+        move_all(result, block_result);
+
+        end_block_invocation(block_result, mark);
+    }
+}
+
+/**
+* @brief Faz push dos elementos [start, end[ de um array para os quais o bloco deixa um truthy no topo
+* @param result stack onde ficam os elementos
+* @param array target
+* @param start primeiro elemento
+* @param end elemento a seguir ao último
+* @param block_element block to execute
+* @param variables value of variables
+*/
+static void filter_blocks_range(Stack *result, Stack *array, int start, int end, StackElement block_element,
+                                StackElement *variables) {
+    ArenaMark mark = begin_block_invocations();
+    BlockMemo memo;
+    start_block_memo(&memo, block_element, variables, end - start);
+
+    for (int i = start; i < end; ++i) {
+        StackElement current_element = get_element_at(array, i);
+        Stack *current_element_result = execute_memoized_block(&memo, current_element, block_element, variables);
+
+        if (length(current_element_result) > 0) {
+            StackElement first_element = pop(current_element_result);
+            if (is_truthy(&first_element)) {
+                push(result, duplicate_element(current_element));
+            }
+            free_element(first_element);
+        }
+
+        end_block_invocation(current_element_result, mark);
+    }
+}
+
+/**
+* @brief Executa uma parte de um map ou filter paralelo
+* @param context o ParallelBlockJob
+* @param start primeiro elemento
+* @param end elemento a seguir ao último
+*/
+static void run_parallel_block_range(void *context, int start, int end) {
+    ParallelBlockJob *job = context;
+    Stack *result = create_stack(end - start);
+
+    job->function(result, job->array, start, end, job->block_element, job->variables);
+
+    job->results[start / job->grain] = result;
+}
+
+/**
+* @brief Verifica se um bloco pode ser aplicado aos elementos de um array em paralelo: o array é grande, os seus
+* elementos não têm contadores de referências (arrays de longs, doubles ou chars) e o bloco não tem efeitos
+* secundários (ver is_thread_safe_block)
+* @param array target
+* @param block_element block to execute
+* @param variables value of variables
+* @return 1 se pode ser executado em paralelo
+*/
+static int can_run_blocks_in_parallel(Stack *array, StackElement block_element, StackElement *variables) {
+    if (length(array) < PARALLEL_MIN_LENGTH || get_thread_pool_size() <= 1) return 0;
+
+    switch (array->storage) {
+        case LONG_STORAGE:
+        case DOUBLE_STORAGE:
+        case CHAR_STORAGE:
+            return is_thread_safe_block(block_element, variables);
+        case NAN_BOXED_STORAGE:
+        case BOXED_STORAGE:
+        default:
+            return 0;
+    }
+}
 
-    for (int i = 0; i < array_target_length; ++i) {
-        StackElement target = duplicate_element(array->array[i]);
-        Stack *result = execute_block(target, block_element, variables);
+/**
+* @brief Aplica uma BlockRangeFunction a todos os elementos de um array, em paralelo quando possível.
+* Os resultados ficam pela ordem dos elementos.
+* @param function a função
+* @param array target
+* @param block_element block to execute
+* @param variables value of variables
+* @return A stack com os resultados
+*/
+static Stack *run_blocks(BlockRangeFunction function, Stack *array, StackElement block_element,
+                         StackElement *variables) {
+    int array_length = length(array);
+    Stack *array_result = create_stack(array_length);
 
-        push_all(array_result, result);
+    if (!can_run_blocks_in_parallel(array, block_element, variables)) {
+        function(array_result, array, 0, array_length, block_element, variables);
+        return array_result;
+    }
+
+    int grain = array_length / (get_thread_pool_size() * PARALLEL_PARTS_PER_THREAD);
+    if (grain < PARALLEL_MIN_GRAIN) grain = PARALLEL_MIN_GRAIN;
+    if (grain > PARALLEL_MAX_GRAIN) grain = PARALLEL_MAX_GRAIN;
+
+    int part_count = (array_length + grain - 1) / grain;
+    ParallelBlockJob job = {function, array, block_element, variables, grain,
+                            malloc((size_t) part_count * sizeof(Stack *))};
 
-        free_stack(result);
+    parallel_for(array_length, grain, run_parallel_block_range, &job);
+
+    for (int i = 0; i < part_count; i++) {
+        move_all(array_result, job.results[i]);
+        free_stack(job.results[i]);
     }
+    free(job.results);
 
     return array_result;
 }
 
+/**
+* @brief Aplica o bloco a todos os elementos deste
+* @param stack target
+* @param block_element block to execute
+* @param variables value of variables
+*/
+Stack *map_blocks(Stack *array, StackElement block_element, StackElement *variables) {
+    return run_blocks(map_blocks_range, array, block_element, variables);
+}
+
 void map_block_array_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement array_element = pop(stack);
@@ -96,9 +396,9 @@ void map_block_array_operation(Stack *stack, StackElement *variables) {
 /**
 * @brief Cria um array a partir de uma string
 * @param string target
+* @param string_length tamanho da string
 */
-Stack *create_string_array(char *string) {
-    int string_length = (int) strlen(string);
+Stack *create_string_array(char *string, int string_length) {
     Stack *result = create_stack(string_length);
 
     for (int i = 0; i < string_length; ++i) {
@@ -115,64 +415,159 @@ Stack *create_string_array(char *string) {
 int compute_string_length_from_stack_string_array(Stack *array) {
     int result = 0;
     for (int i = 0; i < length(array); ++i) {
-        StackElement x = array->array[i];
+        StackElement x = get_element_at(array, i);
         if (x.type == CHAR_TYPE) {
             result++;
         } else if (x.type == STRING_TYPE) {
-            result += (int) strlen(x.content.string_value);
+            result += (int) get_string_length(&x);
         }
     }
     return result;
 }
 
 /**
-* @brief Converte um array para uma string
+* @brief Converte um array de chars/strings para um elemento string
 * @param array target
 */
-char *convert_stack_array_to_string(Stack *array) {
+StackElement convert_stack_array_to_string(Stack *array) {
     int string_length = compute_string_length_from_stack_string_array(array);
     int array_length = length(array);
 
-    char *result = calloc((size_t) string_length + 1, sizeof(char));
+    StackElement result_element = allocate_string_element((size_t) string_length);
+    char *result = get_string_value(&result_element);
 
     int current_index = 0;
     for (int i = 0; i < array_length; ++i) {
-        StackElement current_element = array->array[i];
+        StackElement current_element = get_element_at(array, i);
         if (current_element.type == CHAR_TYPE) {
             result[current_index] = current_element.content.char_value;
             current_index++;
         } else if (current_element.type == STRING_TYPE) {
-            char *current_string = current_element.content.string_value;
-            int current_string_length = (int) strlen(current_string);
-            for (int j = 0; j < current_string_length; ++j) {
-                result[current_index] = current_string[j];
-                current_index++;
-            }
+            size_t current_string_length = get_string_length(&current_element);
+            memcpy(result + current_index, get_string_value(&current_element), current_string_length);
+            current_index += (int) current_string_length;
         } else {
             PANIC("Converting string stack array back to char array contains non string/char element (type: %d).",
                   current_element.type)
         }
     }
 
-    result[current_index] = '\0';
+    return result_element;
+}
+
+/**
+ * Número de valores possíveis de um byte (entradas das tabelas dos maps e filters de strings)
+ */
+#define BYTE_TABLE_SIZE 256
 
-    return result;
+/**
+* @brief Guarda os bytes distintos de uma string pela ordem da primeira ocorrência
+* @param string target
+* @param string_length tamanho da string
+* @param bytes onde guardar os bytes (BYTE_TABLE_SIZE posições)
+* @return O número de bytes distintos
+*/
+static int find_distinct_bytes(const unsigned char *string, int string_length, unsigned char *bytes) {
+    unsigned char seen[BYTE_TABLE_SIZE] = {0};
+    int count = 0;
+
+    for (int i = 0; i < string_length && count < BYTE_TABLE_SIZE; ++i) {
+        if (!seen[string[i]]) {
+            seen[string[i]] = 1;
+            bytes[count++] = string[i];
+        }
+    }
+
+    return count;
+}
+
+/**
+* @brief Constrói a tabela de tradução de um map de string, executando o bloco uma vez por cada byte distinto.
+* O bloco deve ser puro (ver is_thread_safe_block), para o resultado depender apenas do byte.
+* @param string target
+* @param string_length tamanho da string
+* @param block_element block to execute
+* @param variables value of variables
+* @param table onde guardar o char resultado de cada byte
+* @return 1 se o bloco deixa exatamente um char para cada byte, 0 caso contrário (a tabela não pode ser usada)
+*/
+static int build_map_table(const unsigned char *string, int string_length, StackElement block_element,
+                           StackElement *variables, char *table) {
+    unsigned char bytes[BYTE_TABLE_SIZE];
+    int byte_count = find_distinct_bytes(string, string_length, bytes);
+    ArenaMark mark = begin_block_invocations();
+
+    for (int i = 0; i < byte_count; ++i) {
+        Stack *block_result = execute_block(create_char_element((char) bytes[i]), block_element, variables);
+
+        int is_char = length(block_result) == 1 && peek(block_result).type == CHAR_TYPE;
+        if (is_char) table[bytes[i]] = peek(block_result).content.char_value;
+
+        end_block_invocation(block_result, mark);
+        if (!is_char) return 0;
+    }
+
+    return 1;
+}
+
+/**
+* @brief Constrói a tabela de um filter de string (1 se o byte fica na string), executando o bloco uma vez por cada
+* byte distinto. O bloco deve ser puro (ver is_thread_safe_block), para o resultado depender apenas do byte.
+* @param string target
+* @param string_length tamanho da string
+* @param block_element block to execute
+* @param variables value of variables
+* @param table onde guardar o resultado de cada byte
+*/
+static void build_filter_table(const unsigned char *string, int string_length, StackElement block_element,
+                               StackElement *variables, unsigned char *table) {
+    unsigned char bytes[BYTE_TABLE_SIZE];
+    int byte_count = find_distinct_bytes(string, string_length, bytes);
+    ArenaMark mark = begin_block_invocations();
+
+    for (int i = 0; i < byte_count; ++i) {
+        Stack *block_result = execute_block(create_char_element((char) bytes[i]), block_element, variables);
+
+        if (length(block_result) > 0) {
+            StackElement first_element = pop(block_result);
+            table[bytes[i]] = (unsigned char) is_truthy(&first_element);
+            free_element(first_element);
+        }
+
+        end_block_invocation(block_result, mark);
+    }
 }
 
 void map_block_string_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement string_element = pop(stack);
 
-    char *string_target = string_element.content.string_value;
+    char *string_target = get_string_value(&string_element);
+    int string_length = (int) get_string_length(&string_element);
 
-    Stack *string_array = create_string_array(string_target);
+    char table[BYTE_TABLE_SIZE];
+    if (is_thread_safe_block(block_element, variables) &&
+        build_map_table((unsigned char *) string_target, string_length, block_element, variables, table)) {
+        StackElement result_element = allocate_string_element((size_t) string_length);
+        char *result = get_string_value(&result_element);
+
+        for (int i = 0; i < string_length; ++i) {
+            result[i] = table[(unsigned char) string_target[i]];
+        }
+
+        push(stack, result_element);
+
+        free_element(block_element);
+        free_element(string_element);
+        return;
+    }
+
+    Stack *string_array = create_string_array(string_target, string_length);
 
     Stack *map_result = map_blocks(string_array, block_element, variables);
-    char *string_result = convert_stack_array_to_string(map_result);
 
-    push_string(stack, string_result);
+    push(stack, convert_stack_array_to_string(map_result));
 
-    free(string_result);
     free_stack(map_result);
     free_stack(string_array);
     free_element(block_element);
@@ -183,24 +578,8 @@ void filter_block_array_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement array_element = pop(stack);
 
-    Stack *target_array = array_element.content.array_value;
-    int array_length = length(target_array);
-
-    Stack *array_result = create_stack(array_length);
-    for (int i = 0; i < array_length; ++i) {
-        StackElement current_element = duplicate_element(target_array->array[i]);
-        Stack *current_element_result = execute_block(current_element, block_element, variables);
-
-        if (length(current_element_result) > 0) {
-            StackElement first_element = pop(current_element_result);
-            if (is_truthy(&first_element)) {
-                push(array_result, current_element);
-            }
-            free_element(first_element);
-        }
-
-        free_stack(current_element_result);
-    }
+    Stack *array_result = run_blocks(filter_blocks_range, array_element.content.array_value, block_element,
+                                     variables);
 
     push_array(stack, array_result);
 
@@ -212,12 +591,31 @@ void filter_block_string_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement string_element = pop(stack);
 
-    char *target_string = string_element.content.string_value;
-    int string_length = (int) strlen(target_string);
+    char *target_string = get_string_value(&string_element);
+    int string_length = (int) get_string_length(&string_element);
 
     char *string_result = calloc((size_t) string_length + 1, sizeof(char));
     int current_string_result_index = 0;
 
+    unsigned char table[BYTE_TABLE_SIZE] = {0};
+    if (is_thread_safe_block(block_element, variables)) {
+        build_filter_table((unsigned char *) target_string, string_length, block_element, variables, table);
+
+        for (int i = 0; i < string_length; ++i) {
+            string_result[current_string_result_index] = target_string[i];
+            current_string_result_index += table[(unsigned char) target_string[i]];
+        }
+
+        push(stack, create_string_element_with_length(string_result, (size_t) current_string_result_index));
+
+        free(string_result);
+        free_element(block_element);
+        free_element(string_element);
+        return;
+    }
+
+    ArenaMark mark = begin_block_invocations();
+
     for (int i = 0; i < string_length; ++i) {
         char current_char = target_string[i];
         StackElement char_element = create_char_element(current_char);
@@ -233,10 +631,10 @@ void filter_block_string_operation(Stack *stack, StackElement *variables) {
         }
 
         free_element(char_element);
-        free_stack(current_element_result);
+        end_block_invocation(current_element_result, mark);
     }
 
-    push_string(stack, string_result);
+    push(stack, create_string_element_with_length(string_result, (size_t) current_string_result_index));
 
     free(string_result);
     free_element(block_element);
@@ -247,14 +645,18 @@ void filter_block_string_operation(Stack *stack, StackElement *variables) {
 * @brief Compara o tipo dos elementos da stack
 * @param a target
 * @param b target
+* @return Um valor negativo, 0 ou positivo se a for menor, igual ou maior que b
 */
 int compare_elements(StackElement a, StackElement b) {
     if (a.type == STRING_TYPE && b.type == STRING_TYPE) {
-        return strcmp(a.content.string_value, b.content.string_value);
+        return compare_string_elements(&a, &b);
     } else if (a.type == DOUBLE_TYPE || b.type == DOUBLE_TYPE) {
-        return get_element_as_double(&a) - get_element_as_double(&b) > 0;
+        double x = get_element_as_double(&a), y = get_element_as_double(&b);
+        return (x > y) - (x < y);
     } else if (a.type == LONG_TYPE || b.type == LONG_TYPE) {
-        return (int) (get_element_as_long(&a) - get_element_as_long(&b));
+        // Sem subtrair: a diferença de dois longs pode não caber num int (nem num long)
+        long x = get_element_as_long(&a), y = get_element_as_long(&b);
+        return (x > y) - (x < y);
     } else if (a.type == CHAR_TYPE || b.type == CHAR_TYPE) {
         return (int) (convert_element_to_char(&a) - convert_element_to_char(&b));
     }
@@ -262,67 +664,174 @@ int compare_elements(StackElement a, StackElement b) {
 }
 
 /**
-* @brief Insere os elementos num array de forma ordenada
+* @brief Faz push da chave de ordenação (o topo do resultado do bloco) de cada elemento [start, end[ de um array
+* @param result stack onde ficam as chaves
 * @param array target
-* @param length array length
+* @param start primeiro elemento
+* @param end elemento a seguir ao último
 * @param block_element block to execute
 * @param variables value of variables
-* @param compare_function 
 */
-void insertion_sort(StackElement array[], int length, StackElement block_element, StackElement *variables,
-                    int compare_function(StackElement *, StackElement, StackElement, StackElement)) {
-    int j;
-    StackElement key;
-    for (int i = 1; i < length; i++) {
-        key = array[i];
-        j = i - 1;
-
-        while (j >= 0 && compare_function(variables, block_element, array[j], key) > 0) {
-            array[j + 1] = array[j];
-            j = j - 1;
-        }
-        array[j + 1] = key;
+static void sort_keys_range(Stack *result, Stack *array, int start, int end, StackElement block_element,
+                            StackElement *variables) {
+    ArenaMark mark = begin_block_invocations();
+    BlockMemo memo;
+    start_block_memo(&memo, block_element, variables, end - start);
+
+    for (int i = start; i < end; i++) {
+        Stack *block_result = execute_memoized_block(&memo, get_element_at(array, i), block_element, variables);
+        push(result, pop(block_result));
+        end_block_invocation(block_result, mark);
     }
 }
 
 /**
-* @brief Compara dois elementos utilizando o resultado de executar um bloco
-* @param variables target
-* @param block_element block to execute
-* @param a elemento a comparar com b
-* @param b elemento a comparar com a
+* @brief Compara as chaves de duas posições (para merge_sort_order)
+* @param context array das chaves
+* @param a posição
+* @param b posição
+* @return O resultado de compare_elements
 */
-int sort_compare_function(StackElement *variables, StackElement block_element, StackElement a, StackElement b) {
-    Stack *a_block_result = execute_block(a, block_element, variables);
-    Stack *b_block_result = execute_block(b, block_element, variables);
+static int compare_sort_keys(void *context, int a, int b) {
+    StackElement *keys = context;
 
-    StackElement a_compare_element = pop(a_block_result);
-    StackElement b_compare_element = pop(b_block_result);
+    return compare_elements(keys[a], keys[b]);
+}
 
-    int compare_result = compare_elements(a_compare_element, b_compare_element);
+/**
+* @brief Ordena um array (de forma estável) pelas chaves dos seus elementos, com as regras de compare_elements
+* @param array target
+* @param keys stack com a chave de cada elemento (pode ser o próprio array)
+*/
+static void sort_array_by_keys(Stack *array, Stack *keys) {
+    int array_length = length(array);
+    StackElement *key_elements = malloc((size_t) array_length * sizeof(StackElement));
+    int *order = malloc((size_t) array_length * sizeof(int));
 
-    free_element(a_compare_element);
-    free_element(b_compare_element);
+    for (int i = 0; i < array_length; i++) {
+        key_elements[i] = get_element_at(keys, i);
+        order[i] = i;
+    }
 
-    free_stack(a_block_result);
-    free_stack(b_block_result);
+    merge_sort_order(order, array_length, compare_sort_keys, key_elements);
+    permute_stack(array, order);
 
-    return compare_result;
+    free(order);
+    free(key_elements);
 }
 
 void sort_block_array_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
+
+    // Um bloco vazio ordena pelo próprio valor, sem executar o bloco
+    const char *block = block_element.content.block_value;
+    if (string_only_contains_whitespaces(block)) {
+        free_element(block_element);
+        if (peek(stack).type == STRING_TYPE) {
+            sort_string_operation(stack);
+        } else {
+            sort_array_operation(stack);
+        }
+        return;
+    }
+
     StackElement array_element = pop(stack);
 
-    Stack *array_value = array_element.content.array_value;
-    StackElement *array = array_value->array;
+    Stack *array_value = get_mutable_array(&array_element);
 
-    insertion_sort(array, length(array_value), block_element, variables, sort_compare_function);
+    // O bloco é executado uma vez por elemento (em paralelo quando possível) e as chaves são ordenadas
+    Stack *keys = run_blocks(sort_keys_range, array_value, block_element, variables);
+    sort_array_by_keys(array_value, keys);
+    free_stack(keys);
 
     push(stack, array_element);
     free_element(block_element);
 }
 
+/**
+* @brief Verifica se todos os elementos de um array são strings
+* @param array target
+* @param length array length
+* @return 1 se forem todos strings
+*/
+static int is_string_array(Stack *array, int length) {
+    for (int i = 0; i < length; i++) {
+        if (get_element_at(array, i).type != STRING_TYPE) return 0;
+    }
+    return 1;
+}
+
+/**
+* @brief Ordena um array de strings com multikey quicksort
+* @param array target
+* @param length array length
+*/
+static void sort_string_array(Stack *array, int length) {
+    StackElement *elements = malloc((size_t) length * sizeof(StackElement));
+    SortString *strings = malloc((size_t) length * sizeof(SortString));
+    int *order = malloc((size_t) length * sizeof(int));
+
+    for (int i = 0; i < length; i++) {
+        elements[i] = get_element_at(array, i);
+    }
+    for (int i = 0; i < length; i++) {
+        strings[i].chars = (const unsigned char *) get_string_value(&elements[i]);
+        strings[i].length = get_string_length(&elements[i]);
+        strings[i].index = i;
+    }
+
+    multikey_quicksort(strings, (size_t) length);
+
+    for (int i = 0; i < length; i++) {
+        order[i] = strings[i].index;
+    }
+    permute_stack(array, order);
+
+    free(order);
+    free(strings);
+    free(elements);
+}
+
+void sort_array_operation(Stack *stack) {
+    StackElement array_element = pop(stack);
+
+    Stack *array_value = get_mutable_array(&array_element);
+    int array_length = length(array_value);
+
+    if (array_length > 1) {
+        switch (array_value->storage) {
+            case LONG_STORAGE:
+                radix_sort_longs(array_value->longs, (size_t) array_length);
+                break;
+            case DOUBLE_STORAGE:
+                radix_sort_doubles(array_value->doubles, (size_t) array_length);
+                break;
+            case CHAR_STORAGE:
+                counting_sort_chars(array_value->chars, (size_t) array_length);
+                break;
+            case NAN_BOXED_STORAGE:
+            case BOXED_STORAGE:
+            default:
+                // Acima do limite de ordenação paralela as strings usam o merge sort paralelo
+                if (is_string_array(array_value, array_length) && !is_parallel_sort((size_t) array_length)) {
+                    sort_string_array(array_value, array_length);
+                } else {
+                    sort_array_by_keys(array_value, array_value);
+                }
+        }
+    }
+
+    push(stack, array_element);
+}
+
+void sort_string_operation(Stack *stack) {
+    StackElement string_element = pop(stack);
+
+    counting_sort_chars(get_mutable_string(&string_element), get_string_length(&string_element));
+
+    push(stack, string_element);
+}
+
 /**
 * @brief Verifica se o elemento é truthy e @returns retorna o valor lógico do mesmo
 * @param element target
@@ -343,21 +852,220 @@ void while_top_truthy_operation(Stack *stack, StackElement *variables) {
     free_element(block_element);
 }
 
+/**
+ * Número mínimo de elementos de um array para o fold de um operador associativo ser feito em paralelo
+ */
+#define PARALLEL_FOLD_MIN_LENGTH 65536
+
+/**
+ * Número mínimo de elementos de cada parte de um fold paralelo
+ */
+#define PARALLEL_FOLD_MIN_GRAIN 4096
+
+/**
+ * Argumentos de um fold paralelo
+ */
+typedef struct {
+    /** Operador */
+    FoldOperator fold_operator;
+    /** Array target (de longs ou doubles) */
+    Stack *array;
+    /** Número de elementos de cada parte */
+    int grain;
+    /** Resultado de cada parte de um array de longs */
+    long *long_results;
+    /** Resultado de cada parte de um array de doubles */
+    double *double_results;
+} ParallelFoldJob;
+
+/**
+* @brief Retorna o operador associativo de um bloco com apenas esse operador (por exemplo {+} ou {e>})
+* @param block_element bloco do fold
+* @return O operador, NO_FOLD_OPERATOR se o bloco tiver outras instruções
+*/
+static FoldOperator get_fold_operator(StackElement block_element) {
+    CompiledBlock *block = get_compiled_block(block_element.content.block_value);
+    if (block->length != 2) return NO_FOLD_OPERATOR;
+
+    Instruction instruction = block->instructions[0];
+
+    if (instruction.type == VARIABLES_OPERATION_INSTRUCTION) {
+        return instruction.operation.variables_operation == asterisk_operation ? MULTIPLY_FOLD_OPERATOR
+                                                                               : NO_FOLD_OPERATOR;
+    }
+    if (instruction.type != SIMPLE_OPERATION_INSTRUCTION) return NO_FOLD_OPERATOR;
+
+    StackOperationFunction function = instruction.operation.operation_function;
+
+    if (function == add_operation) return ADD_FOLD_OPERATOR;
+    if (function == lesser_value_operation) return MAX_FOLD_OPERATOR;
+    if (function == bigger_value_operation) return MIN_FOLD_OPERATOR;
+    if (function == and_bitwise_operation) return AND_FOLD_OPERATOR;
+    if (function == or_bitwise_operation) return OR_FOLD_OPERATOR;
+    if (function == xor_bitwise_operation) return XOR_FOLD_OPERATOR;
+
+    return NO_FOLD_OPERATOR;
+}
+
+/**
+* @brief Reduz doubles com o operador, com os kernels SIMD apenas quando o runtime é compilado com
+* PARALLEL_FLOAT_FOLDS (reagrupam as operações)
+* @param fold_operator operador
+* @param doubles os doubles
+* @param count número de doubles
+* @return O resultado
+*/
+static double fold_doubles(FoldOperator fold_operator, const double *doubles, int count) {
+#ifdef PARALLEL_FLOAT_FOLDS
+    return reduce_doubles_unordered(fold_operator, doubles, (size_t) count);
+#else
+    return reduce_doubles(fold_operator, doubles, (size_t) count);
+#endif
+}
+
+/**
+* @brief Reduz uma parte de um fold paralelo
+* @param context o ParallelFoldJob
+* @param start primeiro elemento
+* @param end elemento a seguir ao último
+*/
+static void run_parallel_fold_range(void *context, int start, int end) {
+    ParallelFoldJob *job = context;
+    int part = start / job->grain;
+
+    if (job->array->storage == LONG_STORAGE) {
+        job->long_results[part] = reduce_longs(job->fold_operator, &job->array->longs[start], (size_t) (end - start));
+    } else {
+        job->double_results[part] = fold_doubles(job->fold_operator, &job->array->doubles[start], end - start);
+    }
+}
+
+/**
+* @brief Verifica se o fold de um array com um operador associativo pode ser feito em paralelo.
+* O fold de doubles muda os arredondamentos ao reagrupar as operações, por isso só é feito em paralelo quando o
+* runtime é compilado com PARALLEL_FLOAT_FOLDS.
+* @param array target
+* @return 1 se pode ser feito em paralelo
+*/
+static int can_fold_in_parallel(Stack *array) {
+    if (length(array) < PARALLEL_FOLD_MIN_LENGTH || get_thread_pool_size() <= 1) return 0;
+
+#ifdef PARALLEL_FLOAT_FOLDS
+    return 1;
+#else
+    return array->storage == LONG_STORAGE;
+#endif
+}
+
+/**
+* @brief Reduz um array de longs ou doubles com um operador associativo. Os arrays grandes são divididos em partes
+* reduzidas em paralelo, e os resultados das partes são combinados dois a dois em árvore.
+* @param array target (com pelo menos um elemento)
+* @param fold_operator operador
+* @return A stack com o resultado
+*/
+static Stack *fold_with_operator(Stack *array, FoldOperator fold_operator) {
+    int array_length = length(array);
+    Stack *result = create_stack(1);
+
+    if (!can_fold_in_parallel(array)) {
+        if (array->storage == LONG_STORAGE) {
+            push_long(result, reduce_longs(fold_operator, array->longs, (size_t) array_length));
+        } else {
+            push_double(result, fold_doubles(fold_operator, array->doubles, array_length));
+        }
+        return result;
+    }
+
+    int grain = array_length / (get_thread_pool_size() * PARALLEL_PARTS_PER_THREAD);
+    if (grain < PARALLEL_FOLD_MIN_GRAIN) grain = PARALLEL_FOLD_MIN_GRAIN;
+
+    int part_count = (array_length + grain - 1) / grain;
+    ParallelFoldJob job = {fold_operator, array, grain, NULL, NULL};
+
+    if (array->storage == LONG_STORAGE) {
+        job.long_results = malloc((size_t) part_count * sizeof(long));
+    } else {
+        job.double_results = malloc((size_t) part_count * sizeof(double));
+    }
+
+    parallel_for(array_length, grain, run_parallel_fold_range, &job);
+
+    for (int width = 1; width < part_count; width *= 2) {
+        for (int i = 0; i + width < part_count; i += 2 * width) {
+            if (job.long_results != NULL) {
+                long pair[2] = {job.long_results[i], job.long_results[i + width]};
+                job.long_results[i] = reduce_longs(fold_operator, pair, 2);
+            } else {
+                double pair[2] = {job.double_results[i], job.double_results[i + width]};
+                job.double_results[i] = fold_doubles(fold_operator, pair, 2);
+            }
+        }
+    }
+
+    if (job.long_results != NULL) {
+        push_long(result, job.long_results[0]);
+        free(job.long_results);
+    } else {
+        push_double(result, job.double_results[0]);
+        free(job.double_results);
+    }
+
+    return result;
+}
+
+/**
+* @brief Verifica se o fold pode ser feito com fold_with_operator: o array é de longs (ou de doubles, sem os
+* operadores bitwise) e o bloco é apenas um operador associativo
+* @param array target
+* @param block_element bloco do fold
+* @return O operador, NO_FOLD_OPERATOR caso o bloco tenha de ser executado
+*/
+static FoldOperator get_array_fold_operator(Stack *array, StackElement block_element) {
+    if (length(array) == 0) return NO_FOLD_OPERATOR;
+
+    FoldOperator fold_operator;
+
+    switch (array->storage) {
+        case LONG_STORAGE:
+            return get_fold_operator(block_element);
+        case DOUBLE_STORAGE:
+            fold_operator = get_fold_operator(block_element);
+            return fold_operator == AND_FOLD_OPERATOR || fold_operator == OR_FOLD_OPERATOR ||
+                   fold_operator == XOR_FOLD_OPERATOR ? NO_FOLD_OPERATOR : fold_operator;
+        case CHAR_STORAGE:
+        case NAN_BOXED_STORAGE:
+        case BOXED_STORAGE:
+        default:
+            return NO_FOLD_OPERATOR;
+    }
+}
+
 void fold_operation(Stack *stack, StackElement *variables) {
     StackElement block_element = pop(stack);
     StackElement array_element = pop(stack);
 
+    if (array_element.type != ARRAY_TYPE) PANIC("Trying to fold a non-array element type (%d).", array_element.type)
+
     Stack *array_value = array_element.content.array_value;
-    StackElement *array = array_value->array;
+
+    FoldOperator fold_operator = get_array_fold_operator(array_value, block_element);
+    if (fold_operator != NO_FOLD_OPERATOR) {
+        push_array(stack, fold_with_operator(array_value, fold_operator));
+
+        free_element(block_element);
+        free_element(array_element);
+        return;
+    }
 
     int array_length = length(array_value);
 
     Stack *stack_result = create_stack(array_length);
 
     if (array_length > 0) {
-        push(stack_result, duplicate_element(array[0]));
+        push(stack_result, duplicate_element(get_element_at(array_value, 0)));
         for (int i = 1; i < array_length; ++i) {
-            push(stack_result, duplicate_element(array[i]));
+            push(stack_result, duplicate_element(get_element_at(array_value, i)));
             execute_block_stack(stack_result, block_element, variables);
         }
     }
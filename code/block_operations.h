@@ -8,20 +8,19 @@
 #include "stack.h"
 
 /**
-* @brief Operação de criar um bloco
-* @param stack target
-* @param word result
-*/
-int try_to_parse_block(Stack *stack, char *word);
-
-/**
-* @brief Executa um bloco com um elemento target na stack
+* @brief Executa um bloco com um elemento target na stack.
+* A stack resultado é temporária (alocada na arena dos blocos) e só é válida até a operação que a pediu voltar à sua marca.
 * @param target_element target
 * @param block_element block to execute
 * @param variables value of variables
 */
 Stack *execute_block(StackElement target_element, StackElement block_element, StackElement *variables);
 
+/**
+* @brief Liberta a memória da arena usada pelas invocações de blocos
+*/
+void free_block_arena(void);
+
 /**
 * @brief Operação de executar um bloco
 * @param stack target
@@ -64,6 +63,19 @@ void filter_block_string_operation(Stack *stack, StackElement *variables);
 */
 void sort_block_array_operation(Stack *stack, StackElement *variables);
 
+/**
+* @brief Operação de ordenar um array pelo valor dos elementos (radix sort para longs, doubles e chars,
+* multikey quicksort para strings)
+* @param stack target
+*/
+void sort_array_operation(Stack *stack);
+
+/**
+* @brief Operação de ordenar os caracteres de uma string
+* @param stack target
+*/
+void sort_string_operation(Stack *stack);
+
 /**
 * @brief Operação de executar o bloco enquanto ele deixar um truthy no topo da stack
 * @param stack target
@@ -0,0 +1,572 @@
+/**
+ * @file compiler.c
+ * @brief Implementação do compilador
+ */
+
+#include <string.h>
+#include "compiler.h"
+#include "parser.h"
+#include "logger.h"
+#include "conversions.h"
+#include "variable_operations.h"
+#include "executor.h"
+#include "optimizer.h"
+#include "jit.h"
+
+/** Capacidade inicial de um bloco compilado */
+#define INITIAL_COMPILED_BLOCK_CAPACITY 8
+
+/** Número máximo de blocos guardados em variáveis (encaixados) analisados por is_thread_safe_block */
+#define MAX_THREAD_SAFE_ANALYSIS_DEPTH 16
+
+/** Número de buckets da cache de blocos compilados */
+#define COMPILED_BLOCK_CACHE_SIZE 256
+
+/**
+ * @brief Entrada da cache de blocos compilados
+ */
+typedef struct compiled_block_cache_entry {
+    /** @brief Texto do bloco */
+    char *block_value;
+    /** @brief Bloco compilado */
+    CompiledBlock *block;
+    /** @brief Próxima entrada do mesmo bucket */
+    struct compiled_block_cache_entry *next;
+} CompiledBlockCacheEntry;
+
+/**
+ * @brief Buckets da cache de blocos compilados
+ */
+static CompiledBlockCacheEntry *compiled_block_cache[COMPILED_BLOCK_CACHE_SIZE];
+
+/**
+ * @brief Número de blocos que passaram a executar a versão otimizada (atualizado atomicamente)
+ */
+static unsigned long tiered_block_count;
+
+/**
+ * @brief Cria e aloca um bloco compilado vazio na memória
+ * @param initial_capacity capacidade inicial
+ * @return O bloco compilado
+ */
+static CompiledBlock *create_compiled_block(int initial_capacity) {
+    CompiledBlock *block = malloc(sizeof(CompiledBlock));
+
+    block->capacity = initial_capacity;
+    block->length = 0;
+    block->instructions = calloc((unsigned long) initial_capacity, sizeof(Instruction));
+    block->jit_state = JIT_INTERPRETED;
+    block->executions = 0;
+    block->jit_code = NULL;
+    block->native_function = NULL;
+    block->source = NULL;
+    block->invocations = 0;
+    block->optimized_block = NULL;
+
+    return block;
+}
+
+/**
+ * @brief Adiciona uma instrução ao fim do bloco compilado
+ * @param block target
+ * @param instruction instrução a adicionar
+ */
+static void add_instruction(CompiledBlock *block, Instruction instruction) {
+    if (block->length >= block->capacity) {
+        block->capacity *= 2;
+        block->instructions = realloc(block->instructions, (unsigned long) block->capacity * sizeof(Instruction));
+    }
+
+    block->instructions[block->length++] = instruction;
+}
+
+/**
+ * @brief Verifica se a word começa com @param{open_char} e acaba com @param{close_char}.
+ * @brief Caso isso aconteça, remove esses caracteres da word.
+ * @param word target
+ * @param open_char caractere de abrir
+ * @param close_char caractere de fechar
+ * @return O conteudo interior da word, NULL caso a word não esteja delimitada pelos caracteres
+ */
+static char *strip_delimiters(char *word, char open_char, char close_char) {
+    size_t word_length = strlen(word);
+
+    if (*word != open_char || word[word_length - 1] != close_char) {
+        return NULL;
+    }
+
+    word[word_length - 1] = '\0';
+    return word + 1;
+}
+
+/**
+ * @brief Compila um literal (long, double, string ou bloco)
+ * @param word word para compilar
+ * @param instruction pointer para onde a instrução irá ficar
+ * @return 1 se a word é um literal, 0 caso contrário
+ */
+static int try_to_compile_literal(char *word, Instruction *instruction) {
+    long l;
+    double d;
+    char *inner;
+
+    instruction->type = PUSH_LITERAL_INSTRUCTION;
+
+    if (parse_long(word, &l)) {
+        instruction->literal = create_long_element(l);
+    } else if (parse_double(word, &d)) {
+        instruction->literal = create_double_element(d);
+    } else if ((inner = strip_delimiters(word, '"', '"')) != NULL) {
+        instruction->literal = make_immortal_element(create_string_element(inner));
+    } else if ((inner = strip_delimiters(word, '{', '}')) != NULL) {
+        instruction->literal = make_immortal_element(create_block_element(inner));
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Compila o acesso a uma variável global (":A" ou "A")
+ * @param word word para compilar
+ * @param instruction pointer para onde a instrução irá ficar
+ * @return 1 se a word acede a uma variável, 0 caso contrário
+ */
+static int try_to_compile_variable(char *word, Instruction *instruction) {
+    if (is_variable_key(word[0]) && strlen(word) == 1) {
+        instruction->type = PUSH_VARIABLE_INSTRUCTION;
+        instruction->variable = word[0];
+        return 1;
+    }
+
+    if (word[0] == ':' && is_variable_key(word[1])) {
+        instruction->type = SET_VARIABLE_INSTRUCTION;
+        instruction->variable = word[1];
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compila o input para um bloco de instruções e analisa-o
+ * @param input input bruto
+ * @param optimize 1 para otimizar as instruções, 0 para guardar o texto e otimizar apenas quando o bloco passar a
+ * ser executado muitas vezes
+ * @return O bloco compilado
+ */
+static CompiledBlock *compile_block(char *input, int optimize);
+
+/**
+ * @brief Compila uma word e adiciona a instrução ao bloco
+ * @param word word para compilar
+ * @param data bloco compilado target
+ */
+static void compile_word(char *word, void *data) {
+    CompiledBlock *block = data;
+    Instruction instruction;
+    char *inner;
+
+    PRINT_DEBUG("Compiling: '%s'\n", word)
+
+    if (try_to_compile_literal(word, &instruction) || try_to_compile_variable(word, &instruction)) {
+        add_instruction(block, instruction);
+        return;
+    }
+
+    if ((inner = strip_delimiters(word, '[', ']')) != NULL) {
+        instruction.type = PUSH_ARRAY_INSTRUCTION;
+        // Os arrays são otimizados junto com o bloco onde estão
+        instruction.array_block = compile_block(inner, block->source == NULL);
+    } else if (find_operation(word, &instruction.operation)) {
+        instruction.type = instruction.operation.type == VARIABLES_OPERATION
+                           ? VARIABLES_OPERATION_INSTRUCTION
+                           : SIMPLE_OPERATION_INSTRUCTION;
+    } else {
+        instruction.type = UNKNOWN_OPERATION_INSTRUCTION;
+        instruction.word = strdup(word);
+    }
+
+    add_instruction(block, instruction);
+}
+
+/**
+ * @brief Retorna o bit de uma variável nos conjuntos de variáveis de BlockAnalysis
+ * @param variable caractere da variável (EM UPPER CASE)
+ * @return O bit
+ */
+static unsigned int get_variable_bit(char variable) {
+    return 1u << (variable - 'A');
+}
+
+/**
+ * @brief Acrescenta o efeito de uma instrução ao efeito na stack de um bloco em análise.
+ * Durante a análise analysis->outputs é o número de elementos deixados pelas instruções já analisadas.
+ * @param analysis target
+ * @param inputs número de elementos retirados pela instrução (ou UNKNOWN_STACK_EFFECT)
+ * @param outputs número de elementos deixados pela instrução (ou UNKNOWN_STACK_EFFECT)
+ */
+static void add_stack_effect(BlockAnalysis *analysis, int inputs, int outputs) {
+    // Depois de um efeito desconhecido o número de elementos da stack deixa de ser conhecido
+    if (!analysis->has_stack_effect) return;
+
+    if (inputs == UNKNOWN_STACK_EFFECT || outputs == UNKNOWN_STACK_EFFECT) {
+        analysis->has_stack_effect = 0;
+        return;
+    }
+
+    if (analysis->outputs < inputs) {
+        analysis->inputs += inputs - analysis->outputs;
+        analysis->outputs = inputs;
+    }
+    analysis->outputs += outputs - inputs;
+}
+
+/**
+ * @brief Junta os efeitos (variáveis, input/output e operações desconhecidas) de um bloco que pode ser executado
+ * pelo bloco em análise (um bloco literal ou o conteudo de um array)
+ * @param analysis target
+ * @param inner análise do bloco interior
+ */
+static void add_inner_effects(BlockAnalysis *analysis, const BlockAnalysis *inner) {
+    analysis->variables_read |= inner->variables_read;
+    analysis->variables_written |= inner->variables_written;
+    analysis->reads_input |= inner->reads_input;
+    analysis->writes_output |= inner->writes_output;
+    analysis->runs_unknown_blocks |= inner->runs_unknown_blocks;
+    analysis->has_unknown_operations |= inner->has_unknown_operations;
+}
+
+/**
+ * @brief Junta os efeitos de um literal (se for um bloco) ao bloco em análise
+ * @param analysis target
+ * @param literal literal
+ */
+static void add_literal_effects(BlockAnalysis *analysis, StackElement literal) {
+    if (literal.type == BLOCK_TYPE) {
+        add_inner_effects(analysis, &get_compiled_block(literal.content.block_value)->analysis);
+    }
+}
+
+/**
+ * @brief Junta os efeitos de uma operação ao bloco em análise
+ * @param analysis target
+ * @param operation operação
+ */
+static void add_operation_effects(BlockAnalysis *analysis, StackOperation operation) {
+    analysis->reads_input |= reads_input(operation);
+    analysis->writes_output |= writes_output(operation);
+    add_stack_effect(analysis, operation.inputs, operation.outputs);
+}
+
+/**
+ * @brief Verifica se uma instrução deixa no topo da stack um literal ou array (um bloco no topo é um literal cujos
+ * efeitos já foram juntos à análise)
+ * @param instruction target
+ * @return 1 se o topo da stack é um literal, 0 caso contrário
+ */
+static int pushes_literal(Instruction instruction) {
+    return instruction.type == PUSH_LITERAL_INSTRUCTION || instruction.type == PUSH_ARRAY_INSTRUCTION
+           || instruction.type == SELECT_LITERAL_INSTRUCTION;
+}
+
+/**
+ * @brief Analisa as instruções de um bloco compilado (os blocos literais são compilados e analisados também)
+ * @param block target
+ * @return A análise
+ */
+static BlockAnalysis analyze_compiled_block(CompiledBlock *block) {
+    BlockAnalysis analysis = {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0};
+
+    for (int i = 0; i < block->length; ++i) {
+        Instruction instruction = block->instructions[i];
+        switch (instruction.type) {
+            case PUSH_LITERAL_INSTRUCTION:
+                add_literal_effects(&analysis, instruction.literal);
+                add_stack_effect(&analysis, 0, 1);
+                break;
+            case PUSH_ARRAY_INSTRUCTION:
+                add_inner_effects(&analysis, &instruction.array_block->analysis);
+                add_stack_effect(&analysis, 0, 1);
+                break;
+            case PUSH_VARIABLE_INSTRUCTION:
+                analysis.variables_read |= get_variable_bit(instruction.variable);
+                add_stack_effect(&analysis, 0, 1);
+                break;
+            case SET_VARIABLE_INSTRUCTION:
+                analysis.variables_written |= get_variable_bit(instruction.variable);
+                add_stack_effect(&analysis, 1, 1);
+                break;
+            case VARIABLES_OPERATION_INSTRUCTION:
+                // As operações que executam blocos (~ % * , $ w) executam o bloco do topo da stack, que só é conhecido
+                // se foi empurrado pela instrução anterior
+                analysis.runs_unknown_blocks |= i == 0 || !pushes_literal(block->instructions[i - 1]);
+                add_operation_effects(&analysis, instruction.operation);
+                break;
+            case SIMPLE_OPERATION_INSTRUCTION:
+                add_operation_effects(&analysis, instruction.operation);
+                break;
+            case PUSH_LITERAL_OPERATION_INSTRUCTION:
+                add_literal_effects(&analysis, instruction.literal_operation.literal);
+                add_stack_effect(&analysis, 0, 1);
+                add_operation_effects(&analysis, instruction.literal_operation.operation);
+                break;
+            case DUPLICATE_OPERATION_INSTRUCTION:
+                // Com dois operandos iguais, * e % não executam blocos (precisam de um array ou string por baixo)
+                add_stack_effect(&analysis, 1, 2);
+                add_operation_effects(&analysis, instruction.operation);
+                break;
+            case SELECT_LITERAL_INSTRUCTION:
+                add_literal_effects(&analysis, instruction.select_literals[0]);
+                add_literal_effects(&analysis, instruction.select_literals[1]);
+                add_stack_effect(&analysis, 1, 1);
+                break;
+            case UNKNOWN_OPERATION_INSTRUCTION:
+                analysis.has_unknown_operations = 1;
+                analysis.has_stack_effect = 0;
+                break;
+            case RETURN_INSTRUCTION:
+            default:
+                break;
+        }
+
+        // A verificação à entrada do bloco não pode abortar o programa antes de um output que já teria sido escrito
+        if (analysis.has_stack_effect && !analysis.writes_output && !analysis.runs_unknown_blocks
+            && analysis.verified_length == i) {
+            analysis.verified_length = i + 1;
+            analysis.required_depth = analysis.inputs;
+        }
+    }
+
+    analysis.is_pure = analysis.variables_written == 0 && !analysis.reads_input && !analysis.writes_output
+                       && !analysis.has_unknown_operations;
+
+    if (!analysis.has_stack_effect) {
+        analysis.inputs = 0;
+        analysis.outputs = 0;
+    }
+
+    return analysis;
+}
+
+static CompiledBlock *compile_block(char *input, int optimize) {
+    CompiledBlock *block = create_compiled_block(INITIAL_COMPILED_BLOCK_CAPACITY);
+
+    // O texto é copiado antes de ser separado em words (o tokenizer altera o input)
+    if (!optimize) block->source = strdup(input);
+
+    tokenize(input, compile_word, block);
+
+    Instruction return_instruction;
+    return_instruction.type = RETURN_INSTRUCTION;
+    add_instruction(block, return_instruction);
+
+#ifdef PEEPHOLE_OPTIMIZER
+    if (optimize) optimize_compiled_block(block);
+#endif
+
+    prepare_compiled_block(block);
+    block->analysis = analyze_compiled_block(block);
+
+    return block;
+}
+
+CompiledBlock *compile(char *input) {
+#if defined(TIERED_COMPILATION) && defined(PEEPHOLE_OPTIMIZER)
+    return compile_block(input, 0);
+#else
+    return compile_block(input, 1);
+#endif
+}
+
+CompiledBlock *get_optimized_block(CompiledBlock *block) {
+    if (block->source == NULL) return block;
+
+    CompiledBlock *optimized_block = __atomic_load_n(&block->optimized_block, __ATOMIC_ACQUIRE);
+    if (optimized_block != NULL) return optimized_block;
+
+    PRINT_DEBUG("Optimizing block {%s}\n", block->source)
+
+    // Os blocos literais já estão na cache (foram compilados pela análise do bloco sem otimizações), por isso as
+    // threads da pool também podem otimizar blocos
+    char *source = strdup(block->source);
+    optimized_block = compile_block(source, 1);
+    free(source);
+
+    CompiledBlock *expected = NULL;
+    if (!__atomic_compare_exchange_n(&block->optimized_block, &expected, optimized_block, 0, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        // Outra thread otimizou o bloco ao mesmo tempo
+        free_compiled_block(optimized_block);
+        return expected;
+    }
+
+    __atomic_fetch_add(&tiered_block_count, 1, __ATOMIC_RELAXED);
+    return optimized_block;
+}
+
+CompiledBlock *tier_up_compiled_block(CompiledBlock *block) {
+    if (block->source == NULL) return block;
+
+    CompiledBlock *optimized_block = __atomic_load_n(&block->optimized_block, __ATOMIC_ACQUIRE);
+    if (optimized_block != NULL) return optimized_block;
+
+    // Como no contador do JIT, as execuções perdidas por threads ao mesmo tempo só atrasam a otimização
+    unsigned int invocations = __atomic_load_n(&block->invocations, __ATOMIC_RELAXED) + 1;
+    __atomic_store_n(&block->invocations, invocations, __ATOMIC_RELAXED);
+
+    return invocations >= TIER_UP_THRESHOLD ? get_optimized_block(block) : block;
+}
+
+unsigned long get_tiered_block_count(void) {
+    return __atomic_load_n(&tiered_block_count, __ATOMIC_RELAXED);
+}
+
+void free_compiled_block(CompiledBlock *block) {
+    for (int i = 0; i < block->length; ++i) {
+        Instruction instruction = block->instructions[i];
+        switch (instruction.type) {
+            case PUSH_LITERAL_INSTRUCTION:
+                free_immortal_element(instruction.literal);
+                break;
+            case PUSH_ARRAY_INSTRUCTION:
+                free_compiled_block(instruction.array_block);
+                break;
+            case PUSH_LITERAL_OPERATION_INSTRUCTION:
+                free_immortal_element(instruction.literal_operation.literal);
+                break;
+            case SELECT_LITERAL_INSTRUCTION:
+                free_immortal_element(instruction.select_literals[0]);
+                free_immortal_element(instruction.select_literals[1]);
+                break;
+            case UNKNOWN_OPERATION_INSTRUCTION:
+                free(instruction.word);
+                break;
+            case PUSH_VARIABLE_INSTRUCTION:
+            case SET_VARIABLE_INSTRUCTION:
+            case SIMPLE_OPERATION_INSTRUCTION:
+            case VARIABLES_OPERATION_INSTRUCTION:
+            case DUPLICATE_OPERATION_INSTRUCTION:
+            case RETURN_INSTRUCTION:
+            default:
+                break;
+        }
+    }
+
+    if (block->optimized_block != NULL) free_compiled_block(block->optimized_block);
+
+    free_jit_code(block);
+    free(block->source);
+    free(block->instructions);
+    free(block);
+}
+
+/**
+ * @brief Calcula o hash (FNV-1a) do texto de um bloco
+ * @param block_value texto do bloco
+ * @return O hash
+ */
+static unsigned long hash_block_value(const char *block_value) {
+    unsigned long hash = 14695981039346656037UL;
+
+    while (*block_value) {
+        hash ^= (unsigned char) *block_value++;
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+CompiledBlock *get_compiled_block(char *block_value) {
+    unsigned long bucket = hash_block_value(block_value) % COMPILED_BLOCK_CACHE_SIZE;
+
+    for (CompiledBlockCacheEntry *entry = compiled_block_cache[bucket]; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->block_value, block_value) == 0) {
+            return entry->block;
+        }
+    }
+
+    PRINT_DEBUG("Compiling block {%s}\n", block_value)
+
+    CompiledBlockCacheEntry *entry = malloc(sizeof(CompiledBlockCacheEntry));
+    entry->block_value = strdup(block_value);
+    entry->block = compile(entry->block_value);
+    entry->next = compiled_block_cache[bucket];
+
+    compiled_block_cache[bucket] = entry;
+
+    return entry->block;
+}
+
+void register_native_block(const char *block_value, NativeBlockFunction function) {
+    // get_compiled_block não altera o texto (compila uma cópia)
+    get_compiled_block((char *) block_value)->native_function = function;
+}
+
+/**
+ * @brief Verifica se um elemento pode ser lido por várias threads ao mesmo tempo
+ * @param element target
+ * @param variables variáveis globais
+ * @param depth número de blocos guardados em variáveis já analisados
+ * @return 1 se o elemento é seguro, 0 caso contrário
+ */
+static int is_thread_safe_element(StackElement element, StackElement *variables, int depth);
+
+/**
+ * @brief Verifica se um bloco compilado pode ser executado por várias threads ao mesmo tempo
+ * @param block target
+ * @param variables variáveis globais
+ * @param depth número de blocos guardados em variáveis já analisados
+ * @return 1 se o bloco é seguro, 0 caso contrário
+ */
+static int is_thread_safe_compiled_block(CompiledBlock *block, StackElement *variables, int depth) {
+    if (depth > MAX_THREAD_SAFE_ANALYSIS_DEPTH || !block->analysis.is_pure) return 0;
+
+    // Os literais são imortais, só os valores das variáveis lidas podem ter contadores de referências
+    for (char variable = 'A'; variable <= 'Z'; ++variable) {
+        if ((block->analysis.variables_read & get_variable_bit(variable))
+            && !is_thread_safe_element(get_variable_value(variables, variable), variables, depth)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int is_thread_safe_element(StackElement element, StackElement *variables, int depth) {
+    switch (element.type) {
+        case BLOCK_TYPE:
+            // O bloco é compilado aqui para as threads só lerem a cache
+            return !needs_reference_count(&element)
+                   && is_thread_safe_compiled_block(get_compiled_block(element.content.block_value), variables,
+                                                    depth + 1);
+        case LONG_TYPE:
+        case DOUBLE_TYPE:
+        case CHAR_TYPE:
+        case STRING_TYPE:
+        case ARRAY_TYPE:
+        default:
+            return !needs_reference_count(&element);
+    }
+}
+
+int is_thread_safe_block(StackElement block_element, StackElement *variables) {
+    return is_thread_safe_element(block_element, variables, 0);
+}
+
+void free_compiled_block_cache() {
+    for (int i = 0; i < COMPILED_BLOCK_CACHE_SIZE; ++i) {
+        CompiledBlockCacheEntry *entry = compiled_block_cache[i];
+        while (entry != NULL) {
+            CompiledBlockCacheEntry *next = entry->next;
+
+            free_compiled_block(entry->block);
+            free(entry->block_value);
+            free(entry);
+
+            entry = next;
+        }
+        compiled_block_cache[i] = NULL;
+    }
+}
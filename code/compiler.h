@@ -0,0 +1,212 @@
+/**
+ * @file compiler.h
+ * @brief Responsável de compilar o input para uma lista de instruções
+ */
+
+#pragma once
+
+#include "stack.h"
+#include "operations_storage.h"
+
+/**
+ * @brief Tipos de instruções possíveis
+ */
+typedef enum {
+    /** @brief Faz push de um literal já descodificado (long, double, string ou bloco) */
+    PUSH_LITERAL_INSTRUCTION,
+    /** @brief Executa o bloco compilado do array numa stack nova e faz push dela como array */
+    PUSH_ARRAY_INSTRUCTION,
+    /** @brief Faz push de uma variável global */
+    PUSH_VARIABLE_INSTRUCTION,
+    /** @brief Altera o valor de uma variável global */
+    SET_VARIABLE_INSTRUCTION,
+    /** @brief Executa uma operação que recebe apenas a stack como parametro */
+    SIMPLE_OPERATION_INSTRUCTION,
+    /** @brief Executa uma operação que recebe a stack e as variáveis globais como parametro */
+    VARIABLES_OPERATION_INSTRUCTION,
+    /** @brief Faz push de um literal e executa uma operação (superinstrução criada pelo optimizer, ex: 1 +) */
+    PUSH_LITERAL_OPERATION_INSTRUCTION,
+    /** @brief Duplica o último elemento e executa uma operação (superinstrução criada pelo optimizer, ex: _ *) */
+    DUPLICATE_OPERATION_INSTRUCTION,
+    /** @brief Retira a condição e faz push de um de dois literais (superinstrução criada pelo optimizer para ?) */
+    SELECT_LITERAL_INSTRUCTION,
+    /** @brief Operador sem operação correspondente (aborta o programa quando executado) */
+    UNKNOWN_OPERATION_INSTRUCTION,
+    /** @brief Fim do bloco (última instrução de todos os blocos compilados) */
+    RETURN_INSTRUCTION
+} InstructionType;
+
+/**
+ * Struct do bloco compilado
+ */
+typedef struct compiled_block CompiledBlock;
+
+/**
+ * @brief Struct de uma instrução
+ */
+typedef struct {
+    /** @brief Tipo da instrução */
+    InstructionType type;
+    /** @brief Endereço do código que executa a instrução (usado apenas pelo executor com computed goto) */
+    const void *handler;
+    /** @brief Union do operando da instrução */
+    union {
+        /** @brief Literal para fazer push */
+        StackElement literal;
+        /** @brief Conteudo compilado do array */
+        CompiledBlock *array_block;
+        /** @brief Caractere da variável (EM UPPER CASE) */
+        char variable;
+        /** @brief Operação a executar (também a operação de uma DUPLICATE_OPERATION_INSTRUCTION) */
+        StackOperation operation;
+        /** @brief Literal e operação de uma PUSH_LITERAL_OPERATION_INSTRUCTION */
+        struct {
+            /** @brief Literal para fazer push */
+            StackElement literal;
+            /** @brief Operação a executar depois do push */
+            StackOperation operation;
+        } literal_operation;
+        /** @brief Literais de uma SELECT_LITERAL_INSTRUCTION (o primeiro se a condição for verdadeira) */
+        StackElement select_literals[2];
+        /** @brief Operador sem operação correspondente */
+        char *word;
+    };
+} Instruction;
+
+/**
+ * @brief Resultado da análise de um bloco compilado e dos blocos e arrays dentro dele (calculada uma vez, quando o
+ * bloco é compilado)
+ */
+typedef struct {
+    /** @brief 1 se o bloco não altera variáveis, não faz input/output e só tem operações conhecidas */
+    int is_pure;
+    /** @brief Variáveis lidas (o bit 0 é a variável A) */
+    unsigned int variables_read;
+    /** @brief Variáveis alteradas (o bit 0 é a variável A) */
+    unsigned int variables_written;
+    /** @brief 1 se o bloco lê do stdin (l, t) */
+    int reads_input;
+    /** @brief 1 se o bloco escreve no stdout (p) */
+    int writes_output;
+    /** @brief 1 se o bloco (ou um bloco literal dele) pode executar um bloco que não é literal (vindo de uma variável
+     * ou da stack), cujos efeitos não estão nesta análise */
+    int runs_unknown_blocks;
+    /** @brief 1 se o bloco tem operadores sem operação correspondente */
+    int has_unknown_operations;
+    /** @brief 1 se o número de elementos retirados e deixados na stack não depende dos tipos dos elementos */
+    int has_stack_effect;
+    /** @brief Número de elementos da stack consumidos pelo bloco (se has_stack_effect) */
+    int inputs;
+    /** @brief Número de elementos deixados na stack no lugar dos consumidos (se has_stack_effect) */
+    int outputs;
+    /** @brief Número de instruções do início do bloco verificadas (têm efeito na stack conhecido, não escrevem no
+     * stdout e não executam blocos desconhecidos), que executam sem ler abaixo do fundo da stack se ela tiver
+     * required_depth elementos à entrada */
+    int verified_length;
+    /** @brief Número mínimo de elementos que a stack precisa de ter para executar as instruções verificadas
+     * (verificado pelo executor à entrada do bloco) */
+    int required_depth;
+} BlockAnalysis;
+
+/**
+ * @brief Função C que executa um bloco (gerada pelo transpilador, ver transpiler.c)
+ */
+typedef void (*NativeBlockFunction)(Stack *stack, StackElement *variables);
+
+/**
+ * @brief Definição do struct do bloco compilado com implementação de array dinâmica
+ */
+typedef struct compiled_block {
+    /** @brief Capacidade atual do bloco */
+    int capacity;
+    /** @brief Número de instruções (incluindo a RETURN_INSTRUCTION final) */
+    int length;
+    /** @brief Array das instruções */
+    Instruction *instructions;
+    /** @brief Análise do bloco */
+    BlockAnalysis analysis;
+    /** @brief Estado do código nativo do bloco (ver jit.h), acedido atomicamente */
+    int jit_state;
+    /** @brief Número de execuções do bloco enquanto não tem código nativo (contador do JIT) */
+    unsigned int executions;
+    /** @brief Código nativo do bloco (ver jit.h), NULL se não foi compilado */
+    struct jit_code *jit_code;
+    /** @brief Função C que executa o bloco no lugar das instruções, NULL se o bloco não foi transpilado */
+    NativeBlockFunction native_function;
+    /** @brief Texto do bloco compilado sem otimizações, para o compilar otimizado quando passar a ser executado
+     * muitas vezes (NULL se o bloco foi compilado com otimizações) */
+    char *source;
+    /** @brief Número de execuções do bloco sem otimizações (contador da compilação por níveis) */
+    unsigned int invocations;
+    /** @brief Versão otimizada do bloco, NULL até ser compilada (acedida atomicamente) */
+    struct compiled_block *optimized_block;
+} CompiledBlock;
+
+/**
+ * @brief Compila o input para um bloco de instruções e analisa-o (ver BlockAnalysis).
+ * @brief Com TIERED_COMPILATION o bloco é compilado sem otimizações e só é otimizado quando passar a ser executado
+ * muitas vezes (ver tier_up_compiled_block).
+ * @brief Os blocos literais dentro do input são compilados (para a cache) durante a análise.
+ * @param input input bruto
+ * @return O bloco compilado
+ */
+CompiledBlock *compile(char *input);
+
+/**
+ * @brief Retorna a versão otimizada de um bloco compilado, compilando-a se ainda não existir
+ * @param block bloco compilado
+ * @return O bloco otimizado (pertence ao bloco, é libertado com ele), o próprio bloco se já foi otimizado
+ */
+CompiledBlock *get_optimized_block(CompiledBlock *block);
+
+/**
+ * @brief Conta uma execução de um bloco compilado e retorna a versão a executar: a versão otimizada a partir de
+ * TIER_UP_THRESHOLD execuções, o próprio bloco antes disso
+ * @param block bloco compilado
+ * @return O bloco a executar
+ */
+CompiledBlock *tier_up_compiled_block(CompiledBlock *block);
+
+/**
+ * @brief Retorna o número de blocos que passaram a executar a versão otimizada
+ * @return O número de blocos
+ */
+unsigned long get_tiered_block_count(void);
+
+/**
+ * @brief Liberta a memória ocupada pelo bloco compilado
+ * @param block target
+ */
+void free_compiled_block(CompiledBlock *block);
+
+/**
+ * @brief Retorna o bloco compilado do texto de um bloco.
+ * @brief Cada texto distinto é compilado apenas uma vez, as chamadas seguintes retornam o bloco guardado em cache.
+ * @param block_value texto do bloco
+ * @return O bloco compilado (pertence à cache, não deve ser libertado)
+ */
+CompiledBlock *get_compiled_block(char *block_value);
+
+/**
+ * @brief Associa a função C gerada pelo transpilador ao bloco compilado (em cache) do texto de um bloco, para as
+ * execuções do bloco (~, map, filter, fold, ...) chamarem a função no lugar do executor.
+ * @brief As instruções do bloco continuam a ser usadas pela análise (ex: blocos puros, folds conhecidos).
+ * @param block_value texto do bloco
+ * @param function função que executa o bloco
+ */
+void register_native_block(const char *block_value, NativeBlockFunction function);
+
+/**
+ * @brief Verifica se um bloco pode ser executado por várias threads ao mesmo tempo: o bloco é puro (ver
+ * BlockAnalysis) e só lê variáveis que não precisam de contadores de referências (e que, se forem blocos, também
+ * são seguros). Compila todos esses blocos, para as threads só lerem a cache.
+ * @param block_element elemento bloco
+ * @param variables variáveis globais
+ * @return 1 se o bloco é seguro, 0 caso contrário
+ */
+int is_thread_safe_block(StackElement block_element, StackElement *variables);
+
+/**
+ * @brief Liberta a memória ocupada por todos os blocos guardados em cache
+ */
+void free_compiled_block_cache();
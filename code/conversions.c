@@ -47,10 +47,10 @@ char convert_element_to_char(StackElement *stack_element) {
         case CHAR_TYPE:
             return (*stack_element).content.char_value;
         case STRING_TYPE:
-            if (parse_long((*stack_element).content.string_value, &l)) {
+            if (parse_long(get_string_value(stack_element), &l)) {
                 return (char) l;
             } else {
-                return (*stack_element).content.string_value[0];
+                return get_string_value(stack_element)[0];
             }
         case ARRAY_TYPE:
         case BLOCK_TYPE:
@@ -74,9 +74,9 @@ double convert_element_to_double(StackElement *stack_element) {
         case CHAR_TYPE:
             return (double) (*stack_element).content.char_value;
         case STRING_TYPE:
-            if (parse_double((*stack_element).content.string_value, &x))
+            if (parse_double(get_string_value(stack_element), &x))
                 return x;
-            PANIC("Couldn't convert to double from string %s", (*stack_element).content.string_value)
+            PANIC("Couldn't convert to double from string %s", get_string_value(stack_element))
         case ARRAY_TYPE:
         case BLOCK_TYPE:
         default: PANIC("Couldn't convert to double from type %d", (*stack_element).type)
@@ -99,9 +99,9 @@ long convert_element_to_long(StackElement *stack_element) {
         case CHAR_TYPE:
             return (long) (*stack_element).content.char_value;
         case STRING_TYPE:
-            if (parse_long((*stack_element).content.string_value, &x))
+            if (parse_long(get_string_value(stack_element), &x))
                 return x;
-            PANIC("Couldn't convert to long from string %s", (*stack_element).content.string_value)
+            PANIC("Couldn't convert to long from string %s", get_string_value(stack_element))
         case ARRAY_TYPE:
         case BLOCK_TYPE:
         default: PANIC("Couldn't convert to long from type %d", (*stack_element).type)
@@ -112,47 +112,50 @@ long convert_element_to_long(StackElement *stack_element) {
  * @brief Convertes um array para string
  * @param array_stack target
  * @param dest result
+ * @return O tamanho da string escrita
  */
-static void convert_array_to_string(Stack *array_stack, char *dest) {
+static size_t convert_array_to_string(Stack *array_stack, char *dest) {
+    size_t dest_length = 0;
     *dest = '\0';
 
     int stack_length = length(array_stack);
 
     for (int i = 0; i < stack_length; i++) {
-        StackElement array_elem = array_stack->array[i];
+        StackElement array_elem = get_element_at(array_stack, i);
 
-        char current_element_to_string[MAX_CONVERT_TO_STRING_SIZE];
-        convert_element_to_string(&array_elem, current_element_to_string);
-
-        strcat(dest, current_element_to_string);
+        dest_length += convert_element_to_string(&array_elem, dest + dest_length);
     }
+
+    return dest_length;
 }
 
 /**
  * @brief Converte um elemento para string
  * @param stack_element target
  * @param dest result
+ * @return O tamanho da string escrita
  */
-void convert_element_to_string(StackElement *stack_element, char *dest) {
+size_t convert_element_to_string(StackElement *stack_element, char *dest) {
+    size_t string_length;
+
     switch ((*stack_element).type) {
         case DOUBLE_TYPE:
-            sprintf(dest, "%g", stack_element->content.double_value);
-            return;
+            return (size_t) sprintf(dest, "%g", stack_element->content.double_value);
         case LONG_TYPE:
-            sprintf(dest, "%ld", stack_element->content.long_value);
-            return;
+            return (size_t) sprintf(dest, "%ld", stack_element->content.long_value);
         case CHAR_TYPE:
-            sprintf(dest, "%c", stack_element->content.char_value);
-            return;
+            dest[0] = stack_element->content.char_value;
+            dest[1] = '\0';
+            return 1;
         case STRING_TYPE:
-            strcpy(dest, stack_element->content.string_value);
-            return;
+            string_length = get_string_length(stack_element);
+            memcpy(dest, get_string_value(stack_element), string_length + 1);
+            return string_length;
         case ARRAY_TYPE:
-            convert_array_to_string(stack_element->content.array_value, dest);
-            return;
+            return convert_array_to_string(stack_element->content.array_value, dest);
         case BLOCK_TYPE:
             strcpy(dest, stack_element->content.block_value);
-            return;
+            return strlen(dest);
         default: PANIC("Couldn't convert to string from type %d", (*stack_element).type)
     }
 }
@@ -184,10 +187,15 @@ void convert_last_element_to_long(Stack *stack) {
 void convert_last_element_to_string(Stack *stack) {
     StackElement stack_element = pop(stack);
 
+    if (stack_element.type == STRING_TYPE) {
+        push(stack, stack_element);
+        return;
+    }
+
     char x[MAX_CONVERT_TO_STRING_SIZE];
 
-    convert_element_to_string(&stack_element, x);
-    push_string(stack, x);
+    size_t x_length = convert_element_to_string(&stack_element, x);
+    push(stack, create_string_element_with_length(x, x_length));
 
     free_element(stack_element);
 }
@@ -50,9 +50,11 @@ void convert_last_element_to_string(Stack *stack);
 
 /**
 * @brief Converte um elemento da stack numa string
-* @param stack target
+* @param stack_element target
+* @param dest result
+* @return O tamanho da string escrita
 */
-void convert_element_to_string(StackElement *stack_element, char *dest);
+size_t convert_element_to_string(StackElement *stack_element, char *dest);
 
 /**
  * @brief Converte um elemento da stack no tipo char.
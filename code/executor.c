@@ -0,0 +1,230 @@
+/**
+ * @file executor.c
+ * @brief Implementação do executor de blocos compilados
+ *
+ * Existem duas implementações do ciclo de execução, escolhidas ao compilar:
+ * com THREADED_DISPATCH (GCC/Clang) cada instrução guarda o endereço do código que a executa e o fim de cada
+ * instrução salta diretamente para a seguinte com computed goto; caso contrário é usado um switch portável.
+ * Os blocos executados muitas vezes começam no código nativo do JIT (ver jit.h), que retorna a instrução onde o
+ * ciclo de execução deve continuar. Os blocos transpilados para C (ver transpiler.c) chamam diretamente a sua função.
+ * Com TIERED_COMPILATION os blocos começam sem otimizações e passam à versão otimizada quando são executados muitas
+ * vezes (ver tier_up_compiled_block), que por sua vez passa ao JIT.
+ */
+
+#include "executor.h"
+#include "logger.h"
+#include "variable_operations.h"
+#include "jit.h"
+
+/** Capacidade inicial de arrays */
+#define INITIAL_ARRAY_CAPACITY 5
+
+/**
+ * @brief Retira a condição da stack e faz push de um dos literais de uma SELECT_LITERAL_INSTRUCTION (como ?)
+ * @param stack target
+ * @param select_literals literais (o primeiro se a condição for verdadeira)
+ */
+static void push_selected_literal(Stack *stack, const StackElement *select_literals) {
+    StackElement condition = pop(stack);
+
+    push(stack, duplicate_element(select_literals[is_truthy(&condition) ? 0 : 1]));
+
+    free_element(condition);
+}
+
+/**
+ * @brief Executa o conteudo de um array numa stack nova e faz push dela como array
+ * @param stack target
+ * @param variables variáveis
+ * @param array_block conteudo compilado do array
+ */
+static void push_compiled_array(Stack *stack, StackElement *variables, CompiledBlock *array_block) {
+    Stack *array = create_stack(INITIAL_ARRAY_CAPACITY);
+
+    execute_compiled_block(array, variables, array_block);
+
+    push_array(stack, array);
+}
+
+/**
+ * @brief Verifica à entrada de um bloco que a stack tem os elementos de que as instruções verificadas precisam (ver
+ * BlockAnalysis), por isso o código do JIT dessas instruções não verifica o tamanho da stack
+ * @param stack target
+ * @param block bloco compilado
+ */
+static void check_stack_depth(Stack *stack, const CompiledBlock *block) {
+    // A mesma mensagem que pop, que aconteceria mais à frente no bloco
+    if (length(stack) < block->analysis.required_depth) PANIC("Trying to pop from empty stack")
+}
+
+#if defined(THREADED_DISPATCH) && defined(__GNUC__)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+/**
+ * @brief Salta para o código da próxima instrução
+ */
+#define DISPATCH_NEXT() goto *(++instruction)->handler
+
+/**
+ * @brief Executa um bloco compilado com computed goto
+ * @param stack target
+ * @param variables variáveis
+ * @param block bloco compilado
+ * @param start indice da primeira instrução a executar
+ * @param resolve_handlers_only se 1 apenas resolve o endereço do código de cada instrução, sem executar
+ */
+static void run_compiled_block(Stack *stack, StackElement *variables, CompiledBlock *block, int start,
+                               int resolve_handlers_only) {
+    static const void *const handlers[] = {
+            [PUSH_LITERAL_INSTRUCTION] = &&push_literal_handler,
+            [PUSH_ARRAY_INSTRUCTION] = &&push_array_handler,
+            [PUSH_VARIABLE_INSTRUCTION] = &&push_variable_handler,
+            [SET_VARIABLE_INSTRUCTION] = &&set_variable_handler,
+            [SIMPLE_OPERATION_INSTRUCTION] = &&simple_operation_handler,
+            [VARIABLES_OPERATION_INSTRUCTION] = &&variables_operation_handler,
+            [PUSH_LITERAL_OPERATION_INSTRUCTION] = &&push_literal_operation_handler,
+            [DUPLICATE_OPERATION_INSTRUCTION] = &&duplicate_operation_handler,
+            [SELECT_LITERAL_INSTRUCTION] = &&select_literal_handler,
+            [UNKNOWN_OPERATION_INSTRUCTION] = &&unknown_operation_handler,
+            [RETURN_INSTRUCTION] = &&return_instruction_handler
+    };
+
+    Instruction *instruction = block->instructions;
+
+    if (resolve_handlers_only) {
+        for (int i = 0; i < block->length; ++i) {
+            instruction[i].handler = handlers[instruction[i].type];
+        }
+        return;
+    }
+
+    instruction += start;
+    goto *instruction->handler;
+
+    push_literal_handler:
+    push(stack, duplicate_element(instruction->literal));
+    DISPATCH_NEXT();
+
+    push_array_handler:
+    push_compiled_array(stack, variables, instruction->array_block);
+    DISPATCH_NEXT();
+
+    push_variable_handler:
+    push_variable(stack, variables, instruction->variable);
+    DISPATCH_NEXT();
+
+    set_variable_handler:
+    set_variable(stack, variables, instruction->variable);
+    DISPATCH_NEXT();
+
+    simple_operation_handler:
+    instruction->operation.operation_function(stack);
+    DISPATCH_NEXT();
+
+    variables_operation_handler:
+    instruction->operation.variables_operation(stack, variables);
+    DISPATCH_NEXT();
+
+    push_literal_operation_handler:
+    push(stack, duplicate_element(instruction->literal_operation.literal));
+    execute_operation(instruction->literal_operation.operation, stack, variables);
+    DISPATCH_NEXT();
+
+    duplicate_operation_handler:
+    push(stack, duplicate_element(peek(stack)));
+    execute_operation(instruction->operation, stack, variables);
+    DISPATCH_NEXT();
+
+    select_literal_handler:
+    push_selected_literal(stack, instruction->select_literals);
+    DISPATCH_NEXT();
+
+    unknown_operation_handler:
+    PANIC("Couldn't find operation_function '%s'", instruction->word)
+
+    return_instruction_handler:
+    return;
+}
+
+#pragma GCC diagnostic pop
+
+void prepare_compiled_block(CompiledBlock *block) {
+    run_compiled_block(NULL, NULL, block, 0, 1);
+}
+
+void execute_compiled_block(Stack *stack, StackElement *variables, CompiledBlock *block) {
+    if (block->native_function != NULL) {
+        block->native_function(stack, variables);
+        return;
+    }
+
+    block = tier_up_compiled_block(block);
+    check_stack_depth(stack, block);
+
+    run_compiled_block(stack, variables, block, execute_jit_code(stack, variables, block), 0);
+}
+
+#else
+
+void prepare_compiled_block(CompiledBlock *block) {
+    (void) block;
+}
+
+void execute_compiled_block(Stack *stack, StackElement *variables, CompiledBlock *block) {
+    if (block->native_function != NULL) {
+        block->native_function(stack, variables);
+        return;
+    }
+
+    block = tier_up_compiled_block(block);
+    check_stack_depth(stack, block);
+
+    Instruction *instruction = block->instructions + execute_jit_code(stack, variables, block);
+
+    for (; instruction->type != RETURN_INSTRUCTION; ++instruction) {
+        execute_instruction(stack, variables, instruction);
+    }
+}
+
+#endif
+
+void execute_instruction(Stack *stack, StackElement *variables, const Instruction *instruction) {
+    switch (instruction->type) {
+        case PUSH_LITERAL_INSTRUCTION:
+            push(stack, duplicate_element(instruction->literal));
+            break;
+        case PUSH_ARRAY_INSTRUCTION:
+            push_compiled_array(stack, variables, instruction->array_block);
+            break;
+        case PUSH_VARIABLE_INSTRUCTION:
+            push_variable(stack, variables, instruction->variable);
+            break;
+        case SET_VARIABLE_INSTRUCTION:
+            set_variable(stack, variables, instruction->variable);
+            break;
+        case SIMPLE_OPERATION_INSTRUCTION:
+            instruction->operation.operation_function(stack);
+            break;
+        case VARIABLES_OPERATION_INSTRUCTION:
+            instruction->operation.variables_operation(stack, variables);
+            break;
+        case PUSH_LITERAL_OPERATION_INSTRUCTION:
+            push(stack, duplicate_element(instruction->literal_operation.literal));
+            execute_operation(instruction->literal_operation.operation, stack, variables);
+            break;
+        case DUPLICATE_OPERATION_INSTRUCTION:
+            push(stack, duplicate_element(peek(stack)));
+            execute_operation(instruction->operation, stack, variables);
+            break;
+        case SELECT_LITERAL_INSTRUCTION:
+            push_selected_literal(stack, instruction->select_literals);
+            break;
+        case UNKNOWN_OPERATION_INSTRUCTION:
+            PANIC("Couldn't find operation_function '%s'", instruction->word)
+        case RETURN_INSTRUCTION:
+        default:
+            break;
+    }
+}
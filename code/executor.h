@@ -0,0 +1,32 @@
+/**
+ * @file executor.h
+ * @brief Responsável de executar blocos compilados
+ */
+
+#pragma once
+
+#include "stack.h"
+#include "compiler.h"
+
+/**
+ * @brief Prepara um bloco acabado de compilar para ser executado.
+ * @brief Com THREADED_DISPATCH resolve o endereço do código de cada instrução, caso contrário não faz nada.
+ * @param block bloco compilado
+ */
+void prepare_compiled_block(CompiledBlock *block);
+
+/**
+ * @brief Executa as instruções de um bloco compilado na stack
+ * @param stack target
+ * @param variables variáveis
+ * @param block bloco compilado
+ */
+void execute_compiled_block(Stack *stack, StackElement *variables, CompiledBlock *block);
+
+/**
+ * @brief Executa uma instrução de um bloco compilado na stack (usado pelo switch portável e pelo código do JIT)
+ * @param stack target
+ * @param variables variáveis
+ * @param instruction instrução (a RETURN_INSTRUCTION não faz nada)
+ */
+void execute_instruction(Stack *stack, StackElement *variables, const Instruction *instruction);
@@ -0,0 +1,747 @@
+/**
+ * @file jit.c
+ * @brief Implementação do JIT de templates para x86-64 Linux
+ *
+ * O código nativo de um bloco é uma função int (Stack *stack, StackElement *variables) que guarda a stack em r12 e
+ * as variáveis em r13 e executa as instruções por ordem. Cada template lê o current_index, o storage e o buffer da
+ * stack (as funções C chamadas entre templates podem alterá-los) e só trabalha sobre LONG_STORAGE e DOUBLE_STORAGE,
+ * onde os elementos ocupam 8 bytes e não têm contadores de referências.
+ */
+
+#include "jit.h"
+
+#if defined(TEMPLATE_JIT) && defined(__x86_64__) && defined(__linux__)
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "executor.h"
+#include "operations.h"
+#include "polymorphic_operations.h"
+#include "logger.h"
+
+/** Número de execuções a partir do qual um bloco é compilado para código nativo */
+#define JIT_HOT_EXECUTIONS 1000
+
+/** Número de deoptimizações a partir do qual um bloco volta a ser sempre executado pelo executor */
+#define JIT_MAX_DEOPTIMIZATIONS 1000
+
+/** Capacidade inicial do buffer onde o código é gerado */
+#define INITIAL_CODE_BUFFER_CAPACITY 1024
+
+/** Número máximo de guardas de um template */
+#define MAX_TEMPLATE_GUARDS 4
+
+_Static_assert(offsetof(Stack, buffer) < 128, "Stack fields must be addressable with 8-bit displacements");
+_Static_assert(DOUBLE_STORAGE == LONG_STORAGE + 1 && LONG_STORAGE == NAN_BOXED_STORAGE + 1,
+               "Storage guards compare ranges of storages");
+
+/** Deslocamento de current_index na stack */
+#define STACK_INDEX ((unsigned char) offsetof(Stack, current_index))
+/** Deslocamento de capacity na stack */
+#define STACK_CAPACITY ((unsigned char) offsetof(Stack, capacity))
+/** Deslocamento de storage na stack */
+#define STACK_STORAGE ((unsigned char) offsetof(Stack, storage))
+/** Deslocamento de buffer na stack */
+#define STACK_BUFFER ((unsigned char) offsetof(Stack, buffer))
+
+/**
+ * @brief Função gerada pelo JIT
+ */
+typedef int (*JitFunction)(Stack *, StackElement *);
+
+/**
+ * @brief Código nativo de um bloco
+ */
+struct jit_code {
+    /** @brief Função gerada */
+    JitFunction function;
+    /** @brief Páginas onde o código está */
+    void *memory;
+    /** @brief Tamanho das páginas */
+    size_t size;
+    /** @brief Número de deoptimizações do bloco (atualizado atomicamente) */
+    unsigned long deoptimizations;
+};
+
+/**
+ * @brief Buffer onde o código é gerado (antes de ser copiado para páginas executáveis)
+ */
+typedef struct {
+    /** @brief Bytes gerados */
+    unsigned char *code;
+    /** @brief Número de bytes gerados */
+    size_t length;
+    /** @brief Capacidade do buffer */
+    size_t capacity;
+    /** @brief Posição do epílogo (que retorna o eax) */
+    size_t epilogue;
+    /** @brief 1 se a instrução a ser gerada é uma das instruções verificadas do bloco (ver BlockAnalysis), que não
+     * precisam de verificar o tamanho da stack */
+    int is_depth_verified;
+} CodeBuffer;
+
+/**
+ * @brief Templates de código máquina
+ */
+typedef enum {
+    /** @brief A operação é chamada */
+    NO_TEMPLATE,
+    /** @brief + de longs ou doubles */
+    ADD_TEMPLATE,
+    /** @brief - de longs ou doubles */
+    SUBTRACT_TEMPLATE,
+    /** @brief * de longs ou doubles */
+    MULTIPLY_TEMPLATE,
+    /** @brief < de longs */
+    LESSER_TEMPLATE,
+    /** @brief > de longs */
+    BIGGER_TEMPLATE,
+    /** @brief = de longs */
+    EQUAL_TEMPLATE,
+    /** @brief _ */
+    DUPLICATE_TEMPLATE,
+    /** @brief \ */
+    SWAP_TEMPLATE,
+    /** @brief @ */
+    ROTATE_TEMPLATE,
+    /** @brief ; */
+    POP_TEMPLATE
+} Template;
+
+/**
+ * @brief Saltos das guardas de um template, que são ligados ao código de quando uma guarda falha
+ */
+typedef struct {
+    /** @brief Posições dos deslocamentos dos saltos */
+    size_t positions[MAX_TEMPLATE_GUARDS];
+    /** @brief Número de saltos */
+    int count;
+} Guards;
+
+/**
+ * @brief Contadores do JIT
+ */
+static JitStats jit_stats;
+
+/**
+ * @brief Acrescenta bytes ao código gerado
+ * @param buffer target
+ * @param bytes bytes
+ * @param count número de bytes
+ */
+static void emit(CodeBuffer *buffer, const unsigned char *bytes, size_t count) {
+    if (buffer->length + count > buffer->capacity) {
+        buffer->capacity = 2 * (buffer->capacity + count);
+        buffer->code = realloc(buffer->code, buffer->capacity);
+    }
+
+    memcpy(buffer->code + buffer->length, bytes, count);
+    buffer->length += count;
+}
+
+/**
+ * @brief Acrescenta os bytes dados como argumentos ao código gerado
+ */
+#define EMIT(buffer, ...) do { \
+        const unsigned char emitted_bytes[] = {__VA_ARGS__}; \
+        emit(buffer, emitted_bytes, sizeof(emitted_bytes)); \
+    } while (0)
+
+/**
+ * @brief Acrescenta um valor de 32 bits ao código gerado
+ * @param buffer target
+ * @param value valor
+ */
+static void emit_32(CodeBuffer *buffer, uint32_t value) {
+    emit(buffer, (const unsigned char *) &value, sizeof(value));
+}
+
+/**
+ * @brief Acrescenta um valor de 64 bits ao código gerado
+ * @param buffer target
+ * @param value valor
+ */
+static void emit_64(CodeBuffer *buffer, uint64_t value) {
+    emit(buffer, (const unsigned char *) &value, sizeof(value));
+}
+
+/**
+ * @brief Acrescenta um salto com deslocamento de 32 bits por preencher
+ * @param buffer target
+ * @param opcode opcode do salto (E9 para jmp, 0F 8x para saltos condicionais)
+ * @param opcode_length número de bytes do opcode
+ * @return A posição do deslocamento (ver patch_jump)
+ */
+static size_t emit_jump(CodeBuffer *buffer, const unsigned char *opcode, size_t opcode_length) {
+    emit(buffer, opcode, opcode_length);
+    size_t position = buffer->length;
+    emit_32(buffer, 0);
+    return position;
+}
+
+/**
+ * @brief Preenche o deslocamento de um salto
+ * @param buffer target
+ * @param position posição do deslocamento
+ * @param target posição para onde saltar
+ */
+static void patch_jump(CodeBuffer *buffer, size_t position, size_t target) {
+    int32_t displacement = (int32_t) ((long) target - (long) (position + sizeof(int32_t)));
+    memcpy(buffer->code + position, &displacement, sizeof(displacement));
+}
+
+/**
+ * @brief Acrescenta um salto condicional para o código de quando uma guarda falha
+ * @param buffer target
+ * @param guards saltos do template
+ * @param condition segundo byte do opcode (0x8C jl, 0x8D jge, 0x85 jne, 0x84 je, 0x87 ja)
+ */
+static void emit_guard(CodeBuffer *buffer, Guards *guards, unsigned char condition) {
+    const unsigned char opcode[] = {0x0F, condition};
+    guards->positions[guards->count++] = emit_jump(buffer, opcode, sizeof(opcode));
+}
+
+/**
+ * @brief Acrescenta mov eax, @param{index} e o salto para o epílogo (a função retorna @param{index})
+ * @param buffer target
+ * @param index indice da instrução onde o executor deve continuar
+ */
+static void emit_return_index(CodeBuffer *buffer, int index) {
+    EMIT(buffer, 0xB8);
+    emit_32(buffer, (uint32_t) index);
+
+    const unsigned char jmp[] = {0xE9};
+    patch_jump(buffer, emit_jump(buffer, jmp, sizeof(jmp)), buffer->epilogue);
+}
+
+/**
+ * @brief Acrescenta uma chamada a uma função C com a stack (e as variáveis e um pointer) como argumentos
+ * @param buffer target
+ * @param function endereço da função
+ * @param with_variables 1 para passar as variáveis no segundo argumento
+ * @param pointer terceiro argumento (se with_variables) ou segundo argumento, NULL para nenhum
+ */
+static void emit_call(CodeBuffer *buffer, uintptr_t function, int with_variables, const void *pointer) {
+    EMIT(buffer, 0x4C, 0x89, 0xE7); // mov rdi, r12
+    if (with_variables) EMIT(buffer, 0x4C, 0x89, 0xEE); // mov rsi, r13
+
+    if (pointer != NULL) {
+        if (with_variables) {
+            EMIT(buffer, 0x48, 0xBA); // mov rdx, imm64
+        } else {
+            EMIT(buffer, 0x48, 0xBE); // mov rsi, imm64
+        }
+        emit_64(buffer, (uint64_t) (uintptr_t) pointer);
+    }
+
+    EMIT(buffer, 0x48, 0xB8); // mov rax, imm64
+    emit_64(buffer, (uint64_t) function);
+    EMIT(buffer, 0xFF, 0xD0); // call rax
+}
+
+/**
+ * @brief Acrescenta a chamada de uma operação
+ * @param buffer target
+ * @param operation operação
+ */
+static void emit_call_operation(CodeBuffer *buffer, StackOperation operation) {
+    if (operation.type == VARIABLES_OPERATION) {
+        emit_call(buffer, (uintptr_t) operation.variables_operation, 1, NULL);
+    } else {
+        emit_call(buffer, (uintptr_t) operation.operation_function, 0, NULL);
+    }
+}
+
+/**
+ * @brief Faz push de uma cópia de um literal (chamada pelo código nativo)
+ * @param stack target
+ * @param literal literal
+ */
+static void push_literal(Stack *stack, const StackElement *literal) {
+    push(stack, duplicate_element(*literal));
+}
+
+/**
+ * @brief Retorna o template de uma operação
+ * @param operation operação
+ * @return O template, NO_TEMPLATE se a operação é chamada
+ */
+static Template get_template(StackOperation operation) {
+    if (operation.type == VARIABLES_OPERATION) {
+        return operation.variables_operation == asterisk_operation ? MULTIPLY_TEMPLATE : NO_TEMPLATE;
+    }
+
+    StackOperationFunction function = operation.operation_function;
+
+    if (function == add_operation) return ADD_TEMPLATE;
+    if (function == minus_operation) return SUBTRACT_TEMPLATE;
+    if (function == lesser_than_symbol_operation) return LESSER_TEMPLATE;
+    if (function == bigger_than_symbol_operation) return BIGGER_TEMPLATE;
+    if (function == equal_symbol_operation) return EQUAL_TEMPLATE;
+    if (function == duplicate_operation) return DUPLICATE_TEMPLATE;
+    if (function == swap_last_two_operation) return SWAP_TEMPLATE;
+    if (function == rotate_last_three_operation) return ROTATE_TEMPLATE;
+    if (function == pop_operation) return POP_TEMPLATE;
+
+    return NO_TEMPLATE;
+}
+
+/**
+ * @brief Acrescenta as instruções que carregam o current_index (eax) e verificam que a stack tem pelo menos
+ * @param{depth} elementos (a verificação é omitida nas instruções verificadas do bloco)
+ * @param buffer target
+ * @param guards saltos do template
+ * @param depth número mínimo de elementos
+ */
+static void emit_load_index(CodeBuffer *buffer, Guards *guards, int depth) {
+    EMIT(buffer, 0x41, 0x8B, 0x44, 0x24, STACK_INDEX); // mov eax, [r12 + current_index]
+    if (buffer->is_depth_verified) return;
+
+    EMIT(buffer, 0x83, 0xF8, (unsigned char) (depth - 1)); // cmp eax, depth - 1
+    emit_guard(buffer, guards, 0x8C); // jl
+}
+
+/**
+ * @brief Acrescenta a guarda que verifica que o storage da stack está entre @param{first} e @param{last}
+ * @param buffer target
+ * @param guards saltos do template
+ * @param first primeiro storage aceite
+ * @param last último storage aceite
+ */
+static void emit_storage_guard(CodeBuffer *buffer, Guards *guards, StackStorage first, StackStorage last) {
+    EMIT(buffer, 0x41, 0x8B, 0x4C, 0x24, STACK_STORAGE); // mov ecx, [r12 + storage]
+    EMIT(buffer, 0x83, 0xE9, (unsigned char) first); // sub ecx, first
+    EMIT(buffer, 0x83, 0xF9, (unsigned char) (last - first)); // cmp ecx, last - first
+    emit_guard(buffer, guards, 0x87); // ja
+}
+
+/**
+ * @brief Acrescenta mov rdx, [r12 + buffer] e movsxd rax, eax (endereçamento dos elementos do topo)
+ * @param buffer target
+ */
+static void emit_load_buffer(CodeBuffer *buffer) {
+    EMIT(buffer, 0x49, 0x8B, 0x54, 0x24, STACK_BUFFER); // mov rdx, [r12 + buffer]
+    EMIT(buffer, 0x48, 0x63, 0xC0); // movsxd rax, eax
+}
+
+/**
+ * @brief Acrescenta o template do push de um long ou double
+ * @param buffer target
+ * @param guards saltos do template
+ * @param literal número
+ */
+static void emit_push_number(CodeBuffer *buffer, Guards *guards, StackElement literal) {
+    StackStorage storage = literal.type == LONG_TYPE ? LONG_STORAGE : DOUBLE_STORAGE;
+    uint64_t bits;
+    memcpy(&bits, &literal.content, sizeof(bits));
+
+    EMIT(buffer, 0x41, 0x8B, 0x44, 0x24, STACK_INDEX); // mov eax, [r12 + current_index]
+    emit_storage_guard(buffer, guards, storage, storage);
+    EMIT(buffer, 0x49, 0x8B, 0x54, 0x24, STACK_BUFFER); // mov rdx, [r12 + buffer]
+    EMIT(buffer, 0x48, 0x85, 0xD2); // test rdx, rdx
+    emit_guard(buffer, guards, 0x84); // je
+    EMIT(buffer, 0x8D, 0x48, 0x01); // lea ecx, [rax + 1]
+    EMIT(buffer, 0x41, 0x3B, 0x4C, 0x24, STACK_CAPACITY); // cmp ecx, [r12 + capacity]
+    emit_guard(buffer, guards, 0x8D); // jge
+    EMIT(buffer, 0x48, 0x63, 0xC9); // movsxd rcx, ecx
+    EMIT(buffer, 0x48, 0xB8); // mov rax, imm64
+    emit_64(buffer, bits);
+    EMIT(buffer, 0x48, 0x89, 0x04, 0xCA); // mov [rdx + rcx * 8], rax
+    EMIT(buffer, 0x41, 0x89, 0x4C, 0x24, STACK_INDEX); // mov [r12 + current_index], ecx
+}
+
+/**
+ * @brief Acrescenta o template de uma operação aritmética ou comparação com os dois elementos do topo
+ * @param buffer target
+ * @param guards saltos do template
+ * @param template ADD_TEMPLATE, SUBTRACT_TEMPLATE, MULTIPLY_TEMPLATE, LESSER_TEMPLATE, BIGGER_TEMPLATE ou
+ * EQUAL_TEMPLATE
+ */
+static void emit_binary_operation(CodeBuffer *buffer, Guards *guards, Template template) {
+    int is_comparison = template == LESSER_TEMPLATE || template == BIGGER_TEMPLATE || template == EQUAL_TEMPLATE;
+
+    emit_load_index(buffer, guards, 2);
+    // As comparisons de doubles deixam um long, o que muda o storage, por isso só os longs têm template
+    emit_storage_guard(buffer, guards, LONG_STORAGE, is_comparison ? LONG_STORAGE : DOUBLE_STORAGE);
+    emit_load_buffer(buffer);
+
+    size_t double_jump = 0;
+    if (!is_comparison) {
+        EMIT(buffer, 0x85, 0xC9); // test ecx, ecx (0 se LONG_STORAGE)
+        const unsigned char jne[] = {0x0F, 0x85};
+        double_jump = emit_jump(buffer, jne, sizeof(jne));
+    }
+
+    EMIT(buffer, 0x48, 0x8B, 0x4C, 0xC2, 0xF8); // mov rcx, [rdx + rax * 8 - 8]
+    switch (template) {
+        case ADD_TEMPLATE:
+            EMIT(buffer, 0x48, 0x03, 0x0C, 0xC2); // add rcx, [rdx + rax * 8]
+            break;
+        case SUBTRACT_TEMPLATE:
+            EMIT(buffer, 0x48, 0x2B, 0x0C, 0xC2); // sub rcx, [rdx + rax * 8]
+            break;
+        case MULTIPLY_TEMPLATE:
+            EMIT(buffer, 0x48, 0x0F, 0xAF, 0x0C, 0xC2); // imul rcx, [rdx + rax * 8]
+            break;
+        case LESSER_TEMPLATE:
+        case BIGGER_TEMPLATE:
+        case EQUAL_TEMPLATE:
+            EMIT(buffer, 0x48, 0x3B, 0x0C, 0xC2); // cmp rcx, [rdx + rax * 8]
+            EMIT(buffer, 0x0F, template == LESSER_TEMPLATE ? 0x9C : template == BIGGER_TEMPLATE ? 0x9F : 0x94,
+                 0xC1); // setl / setg / sete cl
+            EMIT(buffer, 0x0F, 0xB6, 0xC9); // movzx ecx, cl
+            break;
+        case NO_TEMPLATE:
+        case DUPLICATE_TEMPLATE:
+        case SWAP_TEMPLATE:
+        case ROTATE_TEMPLATE:
+        case POP_TEMPLATE:
+        default:
+            break;
+    }
+    EMIT(buffer, 0x48, 0x89, 0x4C, 0xC2, 0xF8); // mov [rdx + rax * 8 - 8], rcx
+
+    if (!is_comparison) {
+        const unsigned char jmp[] = {0xE9};
+        size_t store_jump = emit_jump(buffer, jmp, sizeof(jmp));
+
+        patch_jump(buffer, double_jump, buffer->length);
+        EMIT(buffer, 0xF2, 0x0F, 0x10, 0x44, 0xC2, 0xF8); // movsd xmm0, [rdx + rax * 8 - 8]
+        EMIT(buffer, 0xF2, 0x0F, template == ADD_TEMPLATE ? 0x58 : template == SUBTRACT_TEMPLATE ? 0x5C : 0x59,
+             0x04, 0xC2); // addsd / subsd / mulsd xmm0, [rdx + rax * 8]
+        EMIT(buffer, 0xF2, 0x0F, 0x11, 0x44, 0xC2, 0xF8); // movsd [rdx + rax * 8 - 8], xmm0
+
+        patch_jump(buffer, store_jump, buffer->length);
+    }
+
+    EMIT(buffer, 0xFF, 0xC8); // dec eax
+    EMIT(buffer, 0x41, 0x89, 0x44, 0x24, STACK_INDEX); // mov [r12 + current_index], eax
+}
+
+/**
+ * @brief Acrescenta o template de uma operação que muda a ordem dos elementos do topo (_ \ @ ;)
+ * @param buffer target
+ * @param guards saltos do template
+ * @param template DUPLICATE_TEMPLATE, SWAP_TEMPLATE, ROTATE_TEMPLATE ou POP_TEMPLATE
+ */
+static void emit_shuffle(CodeBuffer *buffer, Guards *guards, Template template) {
+    // _ e ; copiam e descartam elementos, por isso só os storages sem contadores de referências são aceites
+    StackStorage first = template == SWAP_TEMPLATE || template == ROTATE_TEMPLATE ? NAN_BOXED_STORAGE : LONG_STORAGE;
+    emit_storage_guard(buffer, guards, first, DOUBLE_STORAGE);
+
+    switch (template) {
+        case DUPLICATE_TEMPLATE:
+            emit_load_index(buffer, guards, 1);
+            EMIT(buffer, 0x8D, 0x48, 0x01); // lea ecx, [rax + 1]
+            EMIT(buffer, 0x41, 0x3B, 0x4C, 0x24, STACK_CAPACITY); // cmp ecx, [r12 + capacity]
+            emit_guard(buffer, guards, 0x8D); // jge
+            emit_load_buffer(buffer);
+            EMIT(buffer, 0x4C, 0x8B, 0x04, 0xC2); // mov r8, [rdx + rax * 8]
+            EMIT(buffer, 0x4C, 0x89, 0x44, 0xC2, 0x08); // mov [rdx + rax * 8 + 8], r8
+            EMIT(buffer, 0xFF, 0xC0); // inc eax
+            EMIT(buffer, 0x41, 0x89, 0x44, 0x24, STACK_INDEX); // mov [r12 + current_index], eax
+            break;
+        case SWAP_TEMPLATE:
+            emit_load_index(buffer, guards, 2);
+            emit_load_buffer(buffer);
+            EMIT(buffer, 0x48, 0x8B, 0x4C, 0xC2, 0xF8); // mov rcx, [rdx + rax * 8 - 8]
+            EMIT(buffer, 0x4C, 0x8B, 0x04, 0xC2); // mov r8, [rdx + rax * 8]
+            EMIT(buffer, 0x4C, 0x89, 0x44, 0xC2, 0xF8); // mov [rdx + rax * 8 - 8], r8
+            EMIT(buffer, 0x48, 0x89, 0x0C, 0xC2); // mov [rdx + rax * 8], rcx
+            break;
+        case ROTATE_TEMPLATE:
+            emit_load_index(buffer, guards, 3);
+            emit_load_buffer(buffer);
+            EMIT(buffer, 0x48, 0x8B, 0x4C, 0xC2, 0xF0); // mov rcx, [rdx + rax * 8 - 16]
+            EMIT(buffer, 0x4C, 0x8B, 0x44, 0xC2, 0xF8); // mov r8, [rdx + rax * 8 - 8]
+            EMIT(buffer, 0x4C, 0x8B, 0x0C, 0xC2); // mov r9, [rdx + rax * 8]
+            EMIT(buffer, 0x4C, 0x89, 0x44, 0xC2, 0xF0); // mov [rdx + rax * 8 - 16], r8
+            EMIT(buffer, 0x4C, 0x89, 0x4C, 0xC2, 0xF8); // mov [rdx + rax * 8 - 8], r9
+            EMIT(buffer, 0x48, 0x89, 0x0C, 0xC2); // mov [rdx + rax * 8], rcx
+            break;
+        case POP_TEMPLATE:
+            emit_load_index(buffer, guards, 1);
+            EMIT(buffer, 0xFF, 0xC8); // dec eax
+            EMIT(buffer, 0x41, 0x89, 0x44, 0x24, STACK_INDEX); // mov [r12 + current_index], eax
+            break;
+        case NO_TEMPLATE:
+        case ADD_TEMPLATE:
+        case SUBTRACT_TEMPLATE:
+        case MULTIPLY_TEMPLATE:
+        case LESSER_TEMPLATE:
+        case BIGGER_TEMPLATE:
+        case EQUAL_TEMPLATE:
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Acrescenta o template de uma operação
+ * @param buffer target
+ * @param guards saltos do template
+ * @param template template (diferente de NO_TEMPLATE)
+ */
+static void emit_template(CodeBuffer *buffer, Guards *guards, Template template) {
+    if (template == DUPLICATE_TEMPLATE || template == SWAP_TEMPLATE || template == ROTATE_TEMPLATE
+        || template == POP_TEMPLATE) {
+        emit_shuffle(buffer, guards, template);
+    } else {
+        emit_binary_operation(buffer, guards, template);
+    }
+}
+
+/**
+ * @brief Liga as guardas de um template ao código de quando falham, acrescentado a seguir ao template: retornar ao
+ * executor na instrução @param{index} (se @param{fallback} é NULL) ou chamar a operação
+ * @param buffer target
+ * @param guards saltos do template
+ * @param index indice da instrução
+ * @param fallback operação a chamar quando uma guarda falha, NULL para deoptimizar
+ */
+static void emit_guard_failure(CodeBuffer *buffer, const Guards *guards, int index, const StackOperation *fallback) {
+    const unsigned char jmp[] = {0xE9};
+    size_t skip_jump = emit_jump(buffer, jmp, sizeof(jmp));
+
+    for (int i = 0; i < guards->count; ++i) {
+        patch_jump(buffer, guards->positions[i], buffer->length);
+    }
+
+    if (fallback == NULL) {
+        emit_return_index(buffer, index);
+    } else {
+        emit_call_operation(buffer, *fallback);
+    }
+
+    patch_jump(buffer, skip_jump, buffer->length);
+}
+
+/**
+ * @brief Acrescenta uma operação: o template (com @param{fallback} quando uma guarda falha) ou a chamada
+ * @param buffer target
+ * @param operation operação
+ * @param index indice da instrução
+ * @param deoptimize 1 para deoptimizar quando uma guarda falha, 0 para chamar a operação
+ */
+static void emit_operation(CodeBuffer *buffer, StackOperation operation, int index, int deoptimize) {
+    Template template = get_template(operation);
+    if (template == NO_TEMPLATE) {
+        emit_call_operation(buffer, operation);
+        return;
+    }
+
+    Guards guards = {{0}, 0};
+    emit_template(buffer, &guards, template);
+    emit_guard_failure(buffer, &guards, index, deoptimize ? NULL : &operation);
+}
+
+/**
+ * @brief Acrescenta o push de um literal: o template para longs e doubles (deoptimiza quando uma guarda falha) ou a
+ * chamada
+ * @param buffer target
+ * @param literal literal (pertence à instrução)
+ * @param index indice da instrução
+ */
+static void emit_push_literal(CodeBuffer *buffer, const StackElement *literal, int index) {
+    if (literal->type != LONG_TYPE && literal->type != DOUBLE_TYPE) {
+        emit_call(buffer, (uintptr_t) push_literal, 0, literal);
+        return;
+    }
+
+    Guards guards = {{0}, 0};
+    emit_push_number(buffer, &guards, *literal);
+    emit_guard_failure(buffer, &guards, index, NULL);
+}
+
+/**
+ * @brief Acrescenta o código de uma instrução. A segunda parte das superinstruções chama a operação quando uma
+ * guarda falha, porque a primeira parte já foi executada.
+ * @param buffer target
+ * @param instruction instrução
+ * @param index indice da instrução
+ */
+static void emit_instruction(CodeBuffer *buffer, const Instruction *instruction, int index) {
+    StackOperation duplicate = {SIMPLE_OPERATION, 1, 2, {.operation_function = duplicate_operation}};
+
+    switch (instruction->type) {
+        case PUSH_LITERAL_INSTRUCTION:
+            emit_push_literal(buffer, &instruction->literal, index);
+            break;
+        case SIMPLE_OPERATION_INSTRUCTION:
+        case VARIABLES_OPERATION_INSTRUCTION:
+            emit_operation(buffer, instruction->operation, index, 1);
+            break;
+        case PUSH_LITERAL_OPERATION_INSTRUCTION:
+            emit_push_literal(buffer, &instruction->literal_operation.literal, index);
+            emit_operation(buffer, instruction->literal_operation.operation, index, 0);
+            break;
+        case DUPLICATE_OPERATION_INSTRUCTION:
+            emit_operation(buffer, duplicate, index, 1);
+            emit_operation(buffer, instruction->operation, index, 0);
+            break;
+        case RETURN_INSTRUCTION:
+            emit_return_index(buffer, index);
+            break;
+        case PUSH_ARRAY_INSTRUCTION:
+        case PUSH_VARIABLE_INSTRUCTION:
+        case SET_VARIABLE_INSTRUCTION:
+        case SELECT_LITERAL_INSTRUCTION:
+        case UNKNOWN_OPERATION_INSTRUCTION:
+        default:
+            emit_call(buffer, (uintptr_t) execute_instruction, 1, instruction);
+            break;
+    }
+}
+
+/**
+ * @brief Gera o código nativo de um bloco e copia-o para páginas executáveis
+ * @param block bloco compilado
+ * @return O código nativo, NULL se as páginas não puderam ser alocadas
+ */
+static struct jit_code *compile_jit_code(CompiledBlock *block) {
+    CodeBuffer buffer = {malloc(INITIAL_CODE_BUFFER_CAPACITY), 0, INITIAL_CODE_BUFFER_CAPACITY, 0, 0};
+
+    EMIT(&buffer, 0x41, 0x54); // push r12
+    EMIT(&buffer, 0x41, 0x55); // push r13
+    EMIT(&buffer, 0x53); // push rbx (alinha a stack a 16 bytes para as chamadas)
+    EMIT(&buffer, 0x49, 0x89, 0xFC); // mov r12, rdi
+    EMIT(&buffer, 0x49, 0x89, 0xF5); // mov r13, rsi
+    const unsigned char jmp[] = {0xE9};
+    size_t body_jump = emit_jump(&buffer, jmp, sizeof(jmp));
+
+    buffer.epilogue = buffer.length;
+    EMIT(&buffer, 0x5B); // pop rbx
+    EMIT(&buffer, 0x41, 0x5D); // pop r13
+    EMIT(&buffer, 0x41, 0x5C); // pop r12
+    EMIT(&buffer, 0xC3); // ret
+
+    patch_jump(&buffer, body_jump, buffer.length);
+    for (int i = 0; i < block->length; ++i) {
+        // O executor verificou à entrada que a stack tem os elementos de que as instruções verificadas precisam
+        buffer.is_depth_verified = i < block->analysis.verified_length;
+        emit_instruction(&buffer, &block->instructions[i], i);
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t size = (buffer.length + (size_t) page_size - 1) / (size_t) page_size * (size_t) page_size;
+
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        free(buffer.code);
+        return NULL;
+    }
+
+    memcpy(memory, buffer.code, buffer.length);
+    free(buffer.code);
+
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    struct jit_code *code = malloc(sizeof(struct jit_code));
+    code->function = (JitFunction) (uintptr_t) memory;
+    code->memory = memory;
+    code->size = size;
+    code->deoptimizations = 0;
+
+    PRINT_DEBUG("JIT compiled block: %d instructions -> %lu bytes\n", block->length, (unsigned long) buffer.length)
+
+    __atomic_fetch_add(&jit_stats.compiled_blocks, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&jit_stats.code_bytes, (unsigned long) buffer.length, __ATOMIC_RELAXED);
+
+    return code;
+}
+
+/**
+ * @brief Compila um bloco que passou a ser executado muitas vezes (só a thread que muda o estado para
+ * JIT_COMPILING o compila)
+ * @param block bloco compilado
+ */
+static void compile_hot_block(CompiledBlock *block) {
+    int expected = JIT_INTERPRETED;
+    if (!__atomic_compare_exchange_n(&block->jit_state, &expected, JIT_COMPILING, 0, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    block->jit_code = compile_jit_code(block);
+    __atomic_store_n(&block->jit_state, block->jit_code != NULL ? JIT_COMPILED : JIT_DISABLED, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Conta uma deoptimização de um bloco e desativa o código nativo quando as guardas falham demasiadas vezes
+ * (ex: blocos aplicados a strings)
+ * @param block bloco compilado
+ */
+static void count_deoptimization(CompiledBlock *block) {
+    __atomic_fetch_add(&jit_stats.deoptimizations, 1, __ATOMIC_RELAXED);
+
+    if (__atomic_add_fetch(&block->jit_code->deoptimizations, 1, __ATOMIC_RELAXED) == JIT_MAX_DEOPTIMIZATIONS) {
+        // O código continua alocado até o bloco ser libertado, outras threads podem estar a executá-lo
+        __atomic_store_n(&block->jit_state, JIT_DISABLED, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&jit_stats.disabled_blocks, 1, __ATOMIC_RELAXED);
+    }
+}
+
+int execute_jit_code(Stack *stack, StackElement *variables, CompiledBlock *block) {
+    int state = __atomic_load_n(&block->jit_state, __ATOMIC_ACQUIRE);
+
+    if (state == JIT_COMPILED) {
+        int index = block->jit_code->function(stack, variables);
+        if (index != block->length - 1) count_deoptimization(block);
+        return index;
+    }
+
+    if (state == JIT_INTERPRETED) {
+        // Execuções contadas por várias threads ao mesmo tempo podem perder-se, o que apenas atrasa a compilação
+        unsigned int executions = __atomic_load_n(&block->executions, __ATOMIC_RELAXED) + 1;
+        __atomic_store_n(&block->executions, executions, __ATOMIC_RELAXED);
+
+        if (executions >= JIT_HOT_EXECUTIONS) compile_hot_block(block);
+    }
+
+    return 0;
+}
+
+void free_jit_code(CompiledBlock *block) {
+    if (block->jit_code == NULL) return;
+
+    munmap(block->jit_code->memory, block->jit_code->size);
+    free(block->jit_code);
+    block->jit_code = NULL;
+}
+
+JitStats get_jit_stats(void) {
+    JitStats stats = {
+            __atomic_load_n(&jit_stats.compiled_blocks, __ATOMIC_RELAXED),
+            __atomic_load_n(&jit_stats.code_bytes, __ATOMIC_RELAXED),
+            __atomic_load_n(&jit_stats.deoptimizations, __ATOMIC_RELAXED),
+            __atomic_load_n(&jit_stats.disabled_blocks, __ATOMIC_RELAXED)
+    };
+
+    return stats;
+}
+
+#else
+
+int execute_jit_code(Stack *stack, StackElement *variables, CompiledBlock *block) {
+    (void) stack;
+    (void) variables;
+    (void) block;
+    return 0;
+}
+
+void free_jit_code(CompiledBlock *block) {
+    (void) block;
+}
+
+JitStats get_jit_stats(void) {
+    JitStats stats = {0, 0, 0, 0};
+    return stats;
+}
+
+#endif
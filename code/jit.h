@@ -0,0 +1,65 @@
+/**
+ * @file jit.h
+ * @brief JIT de templates para x86-64 Linux: os blocos executados muitas vezes são compilados para código nativo.
+ *
+ * O código nativo trabalha diretamente sobre a stack: as operações mais frequentes com longs e doubles (+ - * < > =,
+ * push de números e _ \ @ ;) são templates de código máquina com guardas sobre o armazenamento da stack, as outras
+ * instruções chamam as funções C das operações. Quando uma guarda falha o código nativo retorna a instrução onde
+ * estava e o executor continua a execução a partir dela (deoptimização).
+ * Nas outras plataformas (ou sem TEMPLATE_JIT) os blocos são sempre executados pelo executor.
+ */
+
+#pragma once
+
+#include "compiler.h"
+#include "stack.h"
+
+/**
+ * @brief Estados do código nativo de um bloco compilado
+ */
+typedef enum {
+    /** @brief O bloco é executado pelo executor e as execuções são contadas */
+    JIT_INTERPRETED,
+    /** @brief Uma thread está a compilar o bloco */
+    JIT_COMPILING,
+    /** @brief O bloco tem código nativo */
+    JIT_COMPILED,
+    /** @brief O bloco volta a ser sempre executado pelo executor (as guardas falharam demasiadas vezes) */
+    JIT_DISABLED
+} JitState;
+
+/**
+ * Contadores do JIT
+ */
+typedef struct {
+    /** Número de blocos compilados para código nativo */
+    unsigned long compiled_blocks;
+    /** Número de bytes de código nativo gerados */
+    unsigned long code_bytes;
+    /** Número de vezes que o código nativo voltou ao executor por uma guarda falhar */
+    unsigned long deoptimizations;
+    /** Número de blocos que voltaram a ser sempre executados pelo executor */
+    unsigned long disabled_blocks;
+} JitStats;
+
+/**
+ * Executa o código nativo de um bloco, compilando-o quando o bloco passa a ser executado muitas vezes.
+ * @param stack target
+ * @param variables variáveis
+ * @param block bloco compilado (já preparado pelo executor)
+ * @return O indice da instrução onde o executor deve continuar (0 se o bloco não tem código nativo, o indice da
+ * RETURN_INSTRUCTION se o código nativo executou o bloco todo)
+ */
+int execute_jit_code(Stack *stack, StackElement *variables, CompiledBlock *block);
+
+/**
+ * Liberta o código nativo de um bloco compilado
+ * @param block bloco compilado
+ */
+void free_jit_code(CompiledBlock *block);
+
+/**
+ * Retorna os contadores do JIT
+ * @return Os contadores
+ */
+JitStats get_jit_stats(void);
@@ -30,10 +30,7 @@ void bigger_than_double_operation(Stack *stack, double a, double b) {
 }
 
 void bigger_than_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType element_type = peek(stack).type;
-
-    if (element_type == STRING_TYPE && left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 0, STRING_TYPE) && is_element_type(stack, 1, STRING_TYPE)) {
         string_compare_bigger_operation(stack);
     } else {
         operate_promoting_number_type(stack, bigger_than_double_operation, bigger_than_long_operation);
@@ -59,10 +56,7 @@ void lesser_than_double_operation(Stack *stack, double a, double b) {
 }
 
 void lesser_than_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType element_type = peek(stack).type;
-    
-    if (element_type == STRING_TYPE && left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 0, STRING_TYPE) && is_element_type(stack, 1, STRING_TYPE)) {
         string_compare_smaller_operation(stack);
     } else {
         operate_promoting_number_type(stack, lesser_than_double_operation, lesser_than_long_operation);
@@ -88,10 +82,7 @@ void is_equal_double_operation(Stack *stack, double a, double b) {
 }
 
 void is_equal_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType element_type = peek(stack).type;
-    
-    if (element_type == STRING_TYPE && left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 0, STRING_TYPE) && is_element_type(stack, 1, STRING_TYPE)) {
         string_compare_equal_operation(stack);
     } else {
         operate_promoting_number_type(stack, is_equal_double_operation, is_equal_long_operation);
@@ -170,10 +161,7 @@ void lesser_value_double_operation(Stack *stack, double a, double b) {
 }
 
 void lesser_value_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType element_type = peek(stack).type;
-    
-    if (element_type == STRING_TYPE && left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 0, STRING_TYPE) && is_element_type(stack, 1, STRING_TYPE)) {
         string_compare_smaller_value_operation(stack);
     } else {
         operate_promoting_number_type(stack, lesser_value_double_operation, lesser_value_long_operation);
@@ -199,10 +187,7 @@ void bigger_value_double_operation(Stack *stack, double a, double b) {
 }
 
 void bigger_value_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType element_type = peek(stack).type;
-    
-    if (element_type == STRING_TYPE && left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 0, STRING_TYPE) && is_element_type(stack, 1, STRING_TYPE)) {
         string_compare_bigger_value_operation(stack);
     } else {
         operate_promoting_number_type(stack, bigger_value_double_operation, bigger_value_long_operation);
@@ -11,8 +11,14 @@
 #include "conversions.h"
 #include "logger.h"
 #include "operations_storage.h"
-#include "parser.h"
+#include "compiler.h"
+#include "executor.h"
 #include "variable_operations.h"
+#include "block_operations.h"
+#include "thread_pool.h"
+#include "block_memo.h"
+#include "optimizer.h"
+#include "jit.h"
 
 /** Tamanho do buffer de input */
 #define INPUT_BUFFER_SIZE 10001
@@ -32,13 +38,51 @@ int main() {
     Stack *stack = create_stack(INITIAL_STACK_CAPACITY);
     StackElement *variables = create_variable_array();
 
-    tokenize_and_parse(stack, variables, input);
+    CompiledBlock *program = compile(input);
+    execute_compiled_block(stack, variables, program);
 
     dump_stack(stack);
     printf("\n");
 
+#ifdef STATS_MODE
+    for (int worker = 0; worker < get_thread_pool_size(); worker++) {
+        WorkerStats worker_stats = get_worker_stats(worker);
+        fprintf(stderr, "Worker %d: %lu tasks, %lu steals\n", worker, worker_stats.tasks, worker_stats.steals);
+    }
+#endif
+
+    // Os literais dos blocos compilados são partilhados com os elementos, por isso são libertados no fim
+    free_thread_pool();
     free_stack(stack);
     free(variables);
+    free_compiled_block(program);
+    free_compiled_block_cache();
+    free_block_arena();
+    free_block_memo();
+
+#ifdef STATS_MODE
+    OptimizerStats optimizer_stats = get_optimizer_stats();
+    fprintf(stderr, "Optimizer: %lu/%lu instructions removed, %lu constants folded, %lu superinstructions\n",
+            optimizer_stats.removed, optimizer_stats.instructions, optimizer_stats.folded, optimizer_stats.fused);
+
+    fprintf(stderr, "Tiers: %lu blocks optimized after %d executions\n", get_tiered_block_count(),
+            TIER_UP_THRESHOLD);
+
+    JitStats jit_stats = get_jit_stats();
+    fprintf(stderr, "JIT: %lu blocks compiled (%lu bytes), %lu deoptimizations, %lu blocks disabled\n",
+            jit_stats.compiled_blocks, jit_stats.code_bytes, jit_stats.deoptimizations, jit_stats.disabled_blocks);
+
+    BlockMemoStats memo_stats = get_block_memo_stats();
+    fprintf(stderr, "Block memo: %lu hits, %lu misses, %lu evictions\n",
+            memo_stats.hits, memo_stats.misses, memo_stats.evictions);
+
+    StackPoolStats pool_stats = get_stack_pool_stats();
+    fprintf(stderr, "Stack pool: %lu/%lu headers reused, %lu/%lu buffers reused\n",
+            pool_stats.header_hits, pool_stats.header_requests,
+            pool_stats.buffer_hits, pool_stats.buffer_requests);
+#endif
+
+    free_stack_pool();
 
     return 0;
 }
@@ -0,0 +1,279 @@
+/**
+ * @file native_operations.h
+ * @brief Operações usadas pelo código C gerado pelo transpilador (ver transpiler.c).
+ *
+ * As operações mais frequentes com longs e doubles trabalham diretamente sobre a array da stack quando o storage o
+ * permite (as mesmas guardas dos templates do JIT, ver jit.c) e chamam a operação do runtime caso contrário.
+ * São static inline para o compilador as juntar ao código gerado.
+ */
+
+#pragma once
+
+#include <string.h>
+#include "stack.h"
+#include "logica.h"
+#include "operations.h"
+#include "polymorphic_operations.h"
+
+/** Capacidade inicial dos arrays criados pelo código gerado */
+#define NATIVE_ARRAY_CAPACITY 5
+
+_Static_assert(sizeof(long) == sizeof(Value) && sizeof(double) == sizeof(Value),
+               "Typed and NaN-boxed storages must have 8-byte elements");
+
+/**
+ * @brief Retorna o endereço de um elemento de 8 bytes da array da stack (os elementos são copiados com memcpy, por
+ * isso _ \ @ tratam da mesma forma os longs, doubles e valores NaN-boxed)
+ * @param stack target
+ * @param index indice do elemento
+ * @return O endereço do elemento
+ */
+static inline unsigned char *get_native_element(const Stack *stack, int index) {
+    return (unsigned char *) stack->buffer + (size_t) index * sizeof(Value);
+}
+
+/**
+ * @brief Verifica se a stack tem pelo menos @param{depth} elementos guardados em LONG_STORAGE ou DOUBLE_STORAGE
+ * (elementos de 8 bytes sem contadores de referências)
+ * @param stack target
+ * @param depth número mínimo de elementos
+ * @return 1 se a array pode ser alterada diretamente, 0 caso contrário
+ */
+static inline int has_native_numbers(const Stack *stack, int depth) {
+    return stack->current_index >= depth - 1
+           && (stack->storage == LONG_STORAGE || stack->storage == DOUBLE_STORAGE);
+}
+
+/**
+ * @brief Faz push de um long (como push_long)
+ * @param stack target
+ * @param value valor
+ */
+static inline void native_push_long(Stack *stack, long value) {
+    int index = stack->current_index + 1;
+
+    if (stack->storage == LONG_STORAGE && stack->buffer != NULL && index < stack->capacity) {
+        stack->longs[index] = value;
+        stack->current_index = index;
+    } else {
+        push_long(stack, value);
+    }
+}
+
+/**
+ * @brief Faz push de um double (como push_double)
+ * @param stack target
+ * @param value valor
+ */
+static inline void native_push_double(Stack *stack, double value) {
+    int index = stack->current_index + 1;
+
+    if (stack->storage == DOUBLE_STORAGE && stack->buffer != NULL && index < stack->capacity) {
+        stack->doubles[index] = value;
+        stack->current_index = index;
+    } else {
+        push_double(stack, value);
+    }
+}
+
+/**
+ * @brief Operação + (como add_operation)
+ * @param stack target
+ */
+static inline void native_add(Stack *stack) {
+    int index = stack->current_index;
+
+    if (!has_native_numbers(stack, 2)) {
+        add_operation(stack);
+        return;
+    }
+
+    if (stack->storage == LONG_STORAGE) {
+        // Em unsigned para os overflows darem a volta como no resto do runtime
+        unsigned long result = (unsigned long) stack->longs[index - 1] + (unsigned long) stack->longs[index];
+        stack->longs[index - 1] = (long) result;
+    } else {
+        stack->doubles[index - 1] += stack->doubles[index];
+    }
+    stack->current_index = index - 1;
+}
+
+/**
+ * @brief Operação - (como minus_operation)
+ * @param stack target
+ */
+static inline void native_subtract(Stack *stack) {
+    int index = stack->current_index;
+
+    if (!has_native_numbers(stack, 2)) {
+        minus_operation(stack);
+        return;
+    }
+
+    if (stack->storage == LONG_STORAGE) {
+        unsigned long result = (unsigned long) stack->longs[index - 1] - (unsigned long) stack->longs[index];
+        stack->longs[index - 1] = (long) result;
+    } else {
+        stack->doubles[index - 1] -= stack->doubles[index];
+    }
+    stack->current_index = index - 1;
+}
+
+/**
+ * @brief Operação * (como asterisk_operation)
+ * @param stack target
+ * @param variables variáveis
+ */
+static inline void native_multiply(Stack *stack, StackElement *variables) {
+    int index = stack->current_index;
+
+    if (!has_native_numbers(stack, 2)) {
+        asterisk_operation(stack, variables);
+        return;
+    }
+
+    if (stack->storage == LONG_STORAGE) {
+        unsigned long result = (unsigned long) stack->longs[index - 1] * (unsigned long) stack->longs[index];
+        stack->longs[index - 1] = (long) result;
+    } else {
+        stack->doubles[index - 1] *= stack->doubles[index];
+    }
+    stack->current_index = index - 1;
+}
+
+/**
+ * @brief Operação < (como lesser_than_symbol_operation), as comparações de doubles deixam um long e mudam o
+ * storage, por isso só os longs são comparados diretamente
+ * @param stack target
+ */
+static inline void native_lesser(Stack *stack) {
+    int index = stack->current_index;
+
+    if (index >= 1 && stack->storage == LONG_STORAGE) {
+        stack->longs[index - 1] = stack->longs[index - 1] < stack->longs[index];
+        stack->current_index = index - 1;
+    } else {
+        lesser_than_symbol_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação > (como bigger_than_symbol_operation, ver native_lesser)
+ * @param stack target
+ */
+static inline void native_bigger(Stack *stack) {
+    int index = stack->current_index;
+
+    if (index >= 1 && stack->storage == LONG_STORAGE) {
+        stack->longs[index - 1] = stack->longs[index - 1] > stack->longs[index];
+        stack->current_index = index - 1;
+    } else {
+        bigger_than_symbol_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação = (como equal_symbol_operation, ver native_lesser)
+ * @param stack target
+ */
+static inline void native_equal(Stack *stack) {
+    int index = stack->current_index;
+
+    if (index >= 1 && stack->storage == LONG_STORAGE) {
+        stack->longs[index - 1] = stack->longs[index - 1] == stack->longs[index];
+        stack->current_index = index - 1;
+    } else {
+        equal_symbol_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação _ (como duplicate_operation)
+ * @param stack target
+ */
+static inline void native_duplicate(Stack *stack) {
+    int index = stack->current_index;
+
+    if (has_native_numbers(stack, 1) && index + 1 < stack->capacity) {
+        memcpy(get_native_element(stack, index + 1), get_native_element(stack, index), sizeof(Value));
+        stack->current_index = index + 1;
+    } else {
+        duplicate_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação ; (como pop_operation)
+ * @param stack target
+ */
+static inline void native_pop(Stack *stack) {
+    if (has_native_numbers(stack, 1)) {
+        stack->current_index--;
+    } else {
+        pop_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação \ (como swap_last_two_operation), trocar elementos não altera contadores de referências por isso
+ * também aceita NAN_BOXED_STORAGE
+ * @param stack target
+ */
+static inline void native_swap(Stack *stack) {
+    int index = stack->current_index;
+
+    if (index >= 1 && (stack->storage == NAN_BOXED_STORAGE || has_native_numbers(stack, 2))) {
+        Value last;
+        memcpy(&last, get_native_element(stack, index), sizeof(Value));
+        memcpy(get_native_element(stack, index), get_native_element(stack, index - 1), sizeof(Value));
+        memcpy(get_native_element(stack, index - 1), &last, sizeof(Value));
+    } else {
+        swap_last_two_operation(stack);
+    }
+}
+
+/**
+ * @brief Operação @ (como rotate_last_three_operation, ver native_swap)
+ * @param stack target
+ */
+static inline void native_rotate(Stack *stack) {
+    int index = stack->current_index;
+
+    if (index >= 2 && (stack->storage == NAN_BOXED_STORAGE || has_native_numbers(stack, 3))) {
+        Value first;
+        memcpy(&first, get_native_element(stack, index - 2), sizeof(Value));
+        memmove(get_native_element(stack, index - 2), get_native_element(stack, index - 1), 2 * sizeof(Value));
+        memcpy(get_native_element(stack, index), &first, sizeof(Value));
+    } else {
+        rotate_last_three_operation(stack);
+    }
+}
+
+/**
+ * @brief Executa a função de um array numa stack nova e faz push dela como array
+ * @param stack target
+ * @param variables variáveis
+ * @param function função gerada do conteudo do array
+ */
+static inline void native_push_array(Stack *stack, StackElement *variables,
+                                     void (*function)(Stack *, StackElement *)) {
+    Stack *array = create_stack(NATIVE_ARRAY_CAPACITY);
+
+    function(array, variables);
+
+    push_array(stack, array);
+}
+
+/**
+ * @brief Retira a condição de um ? com dois literais (ver SELECT_LITERAL_INSTRUCTION)
+ * @param stack target
+ * @return 1 se a condição é verdadeira, 0 caso contrário
+ */
+static inline int native_pop_condition(Stack *stack) {
+    StackElement condition = pop(stack);
+    int is_true = is_truthy(&condition);
+
+    free_element(condition);
+
+    return is_true;
+}
@@ -39,15 +39,15 @@ long get_element_as_long(StackElement *element) {
 }
 
 /**
- * @brief Converte um elemento para um array.
- * Caso o elemento seja um array, retorna simplesmente o seu conteudo, caso contrário cria um array apenas com o elemento inserido.
+ * @brief Converte um elemento para um array que pode ser alterado.
+ * Caso o elemento seja um array, retorna o seu conteudo (copiado caso seja partilhado), caso contrário cria um array apenas com o elemento inserido.
  * @param element O elemento para converter
  * @return A array do elemento
  */
 static Stack *get_element_as_array(StackElement *element) {
     ElementType type = element->type;
     if (type == ARRAY_TYPE) {
-        return element->content.array_value;
+        return get_mutable_array(element);
     }
 
     Stack *new_array = create_stack(1);
@@ -65,6 +65,18 @@ static Stack *get_element_as_array(StackElement *element) {
 void operate_promoting_number_type(Stack *stack,
                                    void (*double_operation_function_pointer)(Stack *, double, double),
                                    void (*long_operation_function_pointer)(Stack *, long, long)) {
+    long x_long, y_long;
+    if (pop_two_longs(stack, &x_long, &y_long)) {
+        long_operation_function_pointer(stack, x_long, y_long);
+        return;
+    }
+
+    double x_double, y_double;
+    if (pop_two_doubles(stack, &x_double, &y_double)) {
+        double_operation_function_pointer(stack, x_double, y_double);
+        return;
+    }
+
     StackElement y = pop(stack);
     StackElement x = pop(stack);
 
@@ -91,54 +103,69 @@ void operate_promoting_number_type(Stack *stack,
  */
 void add_array_operation(Stack *stack, StackElement *a, StackElement *b) {
     Stack *a_array = get_element_as_array(a);
-    Stack *b_array = get_element_as_array(b);
 
-    for (int i = 0; i < length(b_array); ++i) {
-        push(a_array, duplicate_element(b_array->array[i]));
+    if (b->type == ARRAY_TYPE) {
+        Stack *b_array = b->content.array_value;
+        for (int i = 0; i < length(b_array); ++i) {
+            push(a_array, duplicate_element(get_element_at(b_array, i)));
+        }
+        free_element(*b);
+    } else {
+        push(a_array, *b);
     }
 
     push_array(stack, a_array);
-
-    free_element(*b);
 }
 
 /**
- * @brief Retorna o número de bytes necessários para converter o elemento para string.
- * Caso o elemento seja string, retorna o tamanho da string + 1, caso contrário retorna MAX_CONVERT_TO_STRING_SIZE
- * @param element elemento para calcular
- * @return O número de bytes
+ * @brief Retorna os caracteres de um elemento convertido para string.
+ * Caso o elemento seja string retorna diretamente os seus caracteres, caso contrário converte-o para @param{buffer}
+ * @param element elemento para converter
+ * @param buffer buffer com pelo menos MAX_CONVERT_TO_STRING_SIZE bytes
+ * @param length pointer para onde o tamanho da string irá ficar
+ * @return Os caracteres da string
  */
-static long get_max_string_size(StackElement *element) {
-    if (element->type == STRING_TYPE) return (long) strlen(element->content.string_value) + 1;
-    return MAX_CONVERT_TO_STRING_SIZE;
+static char *get_element_as_string(StackElement *element, char *buffer, size_t *length) {
+    if (element->type == STRING_TYPE) {
+        *length = get_string_length(element);
+        return get_string_value(element);
+    }
+
+    *length = convert_element_to_string(element, buffer);
+    return buffer;
 }
 
 /**
- * @brief Operação de concatenar duas strings/elementos convertidos para string
+ * @brief Operação de concatenar duas strings/elementos convertidos para string.
+ * Caso @param{a} seja string, @param{b} é acrescentado diretamente ao fim dela.
  * @param stack Stack para colocar a string concatenada
  * @param a O primeiro elemento/string
  * @param b O segundo elemento/string
  */
 void add_string_operation(Stack *stack, StackElement *a, StackElement *b) {
-    long max_a_size = get_max_string_size(a);
-    char a_string[max_a_size];
-    long max_b_size = get_max_string_size(b);
-    char b_string[max_b_size];
-
-    convert_element_to_string(a, a_string);
-    convert_element_to_string(b, b_string);
+    char b_buffer[MAX_CONVERT_TO_STRING_SIZE];
+    size_t b_length;
+    char *b_string = get_element_as_string(b, b_buffer, &b_length);
+
+    if (a->type == STRING_TYPE) {
+        append_to_string_element(a, b_string, b_length);
+        push(stack, *a);
+        free_element(*b);
+        return;
+    }
 
-    size_t a_length = strlen(a_string);
-    size_t b_length = strlen(b_string);
+    char a_buffer[MAX_CONVERT_TO_STRING_SIZE];
+    size_t a_length;
+    char *a_string = get_element_as_string(a, a_buffer, &a_length);
 
-    char *concat = calloc(a_length + b_length + 1, sizeof(char));
+    StackElement concat = allocate_string_element(a_length + b_length);
+    char *concat_string = get_string_value(&concat);
 
-    memcpy(concat, a_string, a_length);
-    memcpy(concat + a_length, b_string, b_length + 1);
+    memcpy(concat_string, a_string, a_length);
+    memcpy(concat_string + a_length, b_string, b_length);
 
-    push_string(stack, concat);
+    push(stack, concat);
 
-    free(concat);
     free_element(*a);
     free_element(*b);
 }
@@ -185,6 +212,12 @@ int any_element_is_type(ElementType type, StackElement a, StackElement b) {
 }
 
 void add_operation(Stack *stack) {
+    long x_long, y_long;
+    if (pop_two_longs(stack, &y_long, &x_long)) {
+        add_long_operation(stack, y_long, x_long);
+        return;
+    }
+
     StackElement x = pop(stack);
     StackElement y = pop(stack);
 
@@ -418,7 +451,7 @@ void rotate_last_three_operation(Stack *stack) {
 void copy_nth_element_operation(Stack *stack) {
     long index = pop_long(stack);
 
-    push(stack, get(stack, index));
+    push(stack, duplicate_element(get(stack, index)));
 }
 
 /**
@@ -436,21 +469,20 @@ void read_input_from_console_operation(Stack *stack) {
     if (length > 0 && input[length - 1] == '\n') {
         input[--length] = '\0';
     }
-    push_string(stack, input);
+    push(stack, create_string_element_with_length(input, length));
 }
 
 void read_all_input_from_console_operation(Stack *stack) {
-    char *input = calloc(READ_INPUT_FROM_CONSOLE_MAX_LENGTH, sizeof(char));
-    char *current_line = calloc(READ_INPUT_FROM_CONSOLE_MAX_LENGTH, sizeof(char));
+    StackElement input = allocate_string_element(0);
+    char current_line[READ_INPUT_FROM_CONSOLE_MAX_LENGTH];
+    size_t current_line_length;
 
-    while (fgets(current_line, READ_INPUT_FROM_CONSOLE_MAX_LENGTH, stdin) != NULL && strlen(current_line) > 1) {
-        strcat(input, current_line);
+    while (fgets(current_line, READ_INPUT_FROM_CONSOLE_MAX_LENGTH, stdin) != NULL
+           && (current_line_length = strlen(current_line)) > 1) {
+        append_to_string_element(&input, current_line, current_line_length);
     }
 
-    push_string(stack, input);
-
-    free(input);
-    free(current_line);
+    push(stack, input);
 }
 
 void print_stack_top_operation(Stack *stack) {
@@ -12,68 +12,230 @@
 
 #include "polymorphic_operations.h"
 #include "logger.h"
-#include <string.h>
+#include <limits.h>
 
 /**
- * @brief Macro para criar uma operação simples (que recebe apenas a stack como parametro)
+ * @brief Entrada das tabelas de operações
  */
-#define SIMPLE_OPERATION(simple_operation_function) {SIMPLE_OPERATION, {.operation_function = simple_operation_function}}
+typedef struct {
+    /** @brief Operação */
+    StackOperation operation;
+    /** @brief Nome da função da operação (usado pelo transpilador) */
+    const char *name;
+} OperationTableEntry;
 
 /**
- * @brief Macro para criar uma operação com variáveis globais
+ * @brief Macro para criar uma operação simples (que recebe apenas a stack como parametro) que retira @param{inputs}
+ * elementos da stack e deixa @param{outputs}
  */
-#define VARIABLES_OPERATION(variables_operation_function) {VARIABLES_OPERATION, {.variables_operation = variables_operation_function}}
+#define SIMPLE_OPERATION(simple_operation_function, inputs, outputs) {{SIMPLE_OPERATION, inputs, outputs, {.operation_function = simple_operation_function}}, #simple_operation_function}
 
-StackOperation get_operation(char op[]) {
-    static const StackOperationTableEntry entries[] = {
-            {"+",  SIMPLE_OPERATION(add_operation)},
-            {"-",  SIMPLE_OPERATION(minus_operation)},
-            {"*",  VARIABLES_OPERATION(asterisk_operation)},
-            {"/",  SIMPLE_OPERATION(slash_symbol_operation)},
-            {"%",  VARIABLES_OPERATION(parentheses_symbol_operation)},
-            {"(",  SIMPLE_OPERATION(open_parentheses_operation)},
-            {")",  SIMPLE_OPERATION(close_parentheses_operation)},
-            {"#",  SIMPLE_OPERATION(hashtag_symbol_operation)},
-            {"&",  SIMPLE_OPERATION(and_bitwise_operation)},
-            {"|",  SIMPLE_OPERATION(or_bitwise_operation)},
-            {"^",  SIMPLE_OPERATION(xor_bitwise_operation)},
-            {"~",  VARIABLES_OPERATION(tilde_operation)},
-            {"_",  SIMPLE_OPERATION(duplicate_operation)},
-            {";",  SIMPLE_OPERATION(pop_operation)},
-            {"\\", SIMPLE_OPERATION(swap_last_two_operation)},
-            {"@",  SIMPLE_OPERATION(rotate_last_three_operation)},
-            {"$",  VARIABLES_OPERATION(dollar_symbol_operation)},
-            {"c",  SIMPLE_OPERATION(convert_last_element_to_char)},
-            {"i",  SIMPLE_OPERATION(convert_last_element_to_long)},
-            {"f",  SIMPLE_OPERATION(convert_last_element_to_double)},
-            {"l",  SIMPLE_OPERATION(read_input_from_console_operation)},
-            {"t",  SIMPLE_OPERATION(read_all_input_from_console_operation)},
-            {"s",  SIMPLE_OPERATION(convert_last_element_to_string)},
-            {">",  SIMPLE_OPERATION(bigger_than_symbol_operation)},
-            {"<",  SIMPLE_OPERATION(lesser_than_symbol_operation)},
-            {"=",  SIMPLE_OPERATION(equal_symbol_operation)},
-            {"e&", SIMPLE_OPERATION(and_operation)},
-            {"e|", SIMPLE_OPERATION(or_operation)},
-            {"e>", SIMPLE_OPERATION(lesser_value_operation)},
-            {"e<", SIMPLE_OPERATION(bigger_value_operation)},
-            {"?",  SIMPLE_OPERATION(if_then_else_operation)},
-            {"!",  SIMPLE_OPERATION(not_operation)},
-            {",",  VARIABLES_OPERATION(comma_symbol_operation)},
-            {"S/", SIMPLE_OPERATION(separate_string_by_whitespace_operation)},
-            {"N/", SIMPLE_OPERATION(separate_string_by_new_line_operation)},
-            {"w",  VARIABLES_OPERATION(while_top_truthy_operation)},
-            {"p",  SIMPLE_OPERATION(print_stack_top_operation)}
-    };
-
-    size_t size = sizeof(entries) / sizeof(StackOperationTableEntry);
-
-    for (size_t i = 0; i < size; i++) {
-        if (strcmp(entries[i].operator, op) == 0) {
-            return entries[i].operation;
+/**
+ * @brief Macro para criar uma operação com variáveis globais que retira @param{inputs} elementos da stack e deixa
+ * @param{outputs}
+ */
+#define VARIABLES_OPERATION(variables_operation_function, inputs, outputs) {{VARIABLES_OPERATION, inputs, outputs, {.variables_operation = variables_operation_function}}, #variables_operation_function}
+
+/**
+ * @brief Abreviatura de UNKNOWN_STACK_EFFECT para as tabelas
+ */
+#define UNKNOWN UNKNOWN_STACK_EFFECT
+
+/**
+ * @brief Tabela das operações de um caractere, indexada pelo caractere do operador
+ */
+static const OperationTableEntry single_char_operations[UCHAR_MAX + 1] = {
+        ['+'] = SIMPLE_OPERATION(add_operation, 2, 1),
+        ['-'] = SIMPLE_OPERATION(minus_operation, 2, 1),
+        ['*'] = VARIABLES_OPERATION(asterisk_operation, 2, 1),
+        ['/'] = SIMPLE_OPERATION(slash_symbol_operation, 2, 1),
+        ['%'] = VARIABLES_OPERATION(parentheses_symbol_operation, 2, 1),
+        ['('] = SIMPLE_OPERATION(open_parentheses_operation, UNKNOWN, UNKNOWN),
+        [')'] = SIMPLE_OPERATION(close_parentheses_operation, UNKNOWN, UNKNOWN),
+        ['#'] = SIMPLE_OPERATION(hashtag_symbol_operation, 2, 1),
+        ['&'] = SIMPLE_OPERATION(and_bitwise_operation, 2, 1),
+        ['|'] = SIMPLE_OPERATION(or_bitwise_operation, 2, 1),
+        ['^'] = SIMPLE_OPERATION(xor_bitwise_operation, 2, 1),
+        ['~'] = VARIABLES_OPERATION(tilde_operation, UNKNOWN, UNKNOWN),
+        ['_'] = SIMPLE_OPERATION(duplicate_operation, 1, 2),
+        [';'] = SIMPLE_OPERATION(pop_operation, 1, 0),
+        ['\\'] = SIMPLE_OPERATION(swap_last_two_operation, 2, 2),
+        ['@'] = SIMPLE_OPERATION(rotate_last_three_operation, 3, 3),
+        ['$'] = VARIABLES_OPERATION(dollar_symbol_operation, UNKNOWN, UNKNOWN),
+        ['c'] = SIMPLE_OPERATION(convert_last_element_to_char, 1, 1),
+        ['i'] = SIMPLE_OPERATION(convert_last_element_to_long, 1, 1),
+        ['f'] = SIMPLE_OPERATION(convert_last_element_to_double, 1, 1),
+        ['l'] = SIMPLE_OPERATION(read_input_from_console_operation, 0, 1),
+        ['t'] = SIMPLE_OPERATION(read_all_input_from_console_operation, 0, 1),
+        ['s'] = SIMPLE_OPERATION(convert_last_element_to_string, 1, 1),
+        ['>'] = SIMPLE_OPERATION(bigger_than_symbol_operation, 2, 1),
+        ['<'] = SIMPLE_OPERATION(lesser_than_symbol_operation, 2, 1),
+        ['='] = SIMPLE_OPERATION(equal_symbol_operation, 2, 1),
+        ['?'] = SIMPLE_OPERATION(if_then_else_operation, 3, 1),
+        ['!'] = SIMPLE_OPERATION(not_operation, 1, 1),
+        [','] = VARIABLES_OPERATION(comma_symbol_operation, UNKNOWN, UNKNOWN),
+        ['w'] = VARIABLES_OPERATION(while_top_truthy_operation, UNKNOWN, UNKNOWN),
+        ['p'] = SIMPLE_OPERATION(print_stack_top_operation, 1, 1)
+};
+
+/**
+ * @brief Tabela das operações de dois caracteres começadas por 'e', indexada pelo segundo caractere
+ */
+static const OperationTableEntry e_prefixed_operations[UCHAR_MAX + 1] = {
+        ['&'] = SIMPLE_OPERATION(and_operation, 2, 1),
+        ['|'] = SIMPLE_OPERATION(or_operation, 2, 1),
+        ['>'] = SIMPLE_OPERATION(lesser_value_operation, 2, 1),
+        ['<'] = SIMPLE_OPERATION(bigger_value_operation, 2, 1)
+};
+
+/**
+ * @brief Tabela das operações de dois caracteres começadas por 'S', indexada pelo segundo caractere
+ */
+static const OperationTableEntry s_prefixed_operations[UCHAR_MAX + 1] = {
+        ['/'] = SIMPLE_OPERATION(separate_string_by_whitespace_operation, 1, 1)
+};
+
+/**
+ * @brief Tabela das operações de dois caracteres começadas por 'N', indexada pelo segundo caractere
+ */
+static const OperationTableEntry n_prefixed_operations[UCHAR_MAX + 1] = {
+        ['/'] = SIMPLE_OPERATION(separate_string_by_new_line_operation, 1, 1)
+};
+
+/**
+ * @brief Tabela das tabelas de operações de dois caracteres, indexada pelo primeiro caractere
+ */
+static const OperationTableEntry *const two_char_operations[UCHAR_MAX + 1] = {
+        ['e'] = e_prefixed_operations,
+        ['S'] = s_prefixed_operations,
+        ['N'] = n_prefixed_operations
+};
+
+/**
+ * @brief Operações simples que podem ser calculadas ao compilar quando são aplicadas a números
+ */
+static const StackOperationFunction constant_foldable_operations[] = {
+        add_operation, minus_operation, slash_symbol_operation, open_parentheses_operation,
+        close_parentheses_operation, hashtag_symbol_operation, and_bitwise_operation, or_bitwise_operation,
+        xor_bitwise_operation, convert_last_element_to_char, convert_last_element_to_long,
+        convert_last_element_to_double, bigger_than_symbol_operation, lesser_than_symbol_operation,
+        equal_symbol_operation, not_operation, and_operation, or_operation, lesser_value_operation,
+        bigger_value_operation
+};
+
+/**
+ * @brief Operações com variáveis globais que podem ser calculadas ao compilar quando são aplicadas a números (os
+ * números não usam as variáveis)
+ */
+static const StackOperationVariablesFunction constant_foldable_variables_operations[] = {
+        asterisk_operation, parentheses_symbol_operation, tilde_operation
+};
+
+int find_operation(char op[], StackOperation *to) {
+    unsigned char first_char = (unsigned char) op[0];
+    const OperationTableEntry *entry;
+
+    if (first_char == '\0') return 0;
+
+    if (op[1] == '\0') {
+        entry = &single_char_operations[first_char];
+    } else if (op[2] == '\0' && two_char_operations[first_char] != NULL) {
+        entry = &two_char_operations[first_char][(unsigned char) op[1]];
+    } else {
+        return 0;
+    }
+
+    if (entry->operation.type == NO_OPERATION) return 0;
+
+    *to = entry->operation;
+    return 1;
+}
+
+/**
+ * @brief Procura o nome da função de uma operação numa tabela de operações
+ * @param table tabela
+ * @param operation operação
+ * @return O nome, NULL se a operação não está na tabela
+ */
+static const char *find_operation_name_in_table(const OperationTableEntry *table, StackOperation operation) {
+    for (int i = 0; i <= UCHAR_MAX; ++i) {
+        const StackOperation *entry = &table[i].operation;
+        if (entry->type != operation.type) continue;
+
+        if ((operation.type == SIMPLE_OPERATION && entry->operation_function == operation.operation_function)
+            || (operation.type == VARIABLES_OPERATION && entry->variables_operation == operation.variables_operation)) {
+            return table[i].name;
         }
     }
 
-    PANIC("Couldn't find operation_function '%s'", op)
+    return NULL;
+}
+
+const char *get_operation_name(StackOperation operation) {
+    if (operation.type == NO_OPERATION) return NULL;
+
+    const char *name = find_operation_name_in_table(single_char_operations, operation);
+
+    for (int i = 0; name == NULL && i <= UCHAR_MAX; ++i) {
+        if (two_char_operations[i] != NULL) name = find_operation_name_in_table(two_char_operations[i], operation);
+    }
+
+    return name;
+}
+
+StackOperation get_operation(char op[]) {
+    StackOperation operation;
+
+    if (!find_operation(op, &operation)) PANIC("Couldn't find operation_function '%s'", op)
+
+    return operation;
+}
+
+int reads_input(StackOperation operation) {
+    if (operation.type != SIMPLE_OPERATION) return 0;
+
+    return operation.operation_function == read_input_from_console_operation
+           || operation.operation_function == read_all_input_from_console_operation;
+}
+
+int writes_output(StackOperation operation) {
+    if (operation.type != SIMPLE_OPERATION) return 0;
+
+    return operation.operation_function == print_stack_top_operation;
+}
+
+int has_side_effects(StackOperation operation) {
+    return reads_input(operation) || writes_output(operation);
+}
+
+int is_constant_foldable(StackOperation operation) {
+    switch (operation.type) {
+        case SIMPLE_OPERATION:
+            for (size_t i = 0; i < sizeof(constant_foldable_operations) / sizeof(StackOperationFunction); ++i) {
+                if (operation.operation_function == constant_foldable_operations[i]) return 1;
+            }
+            return 0;
+        case VARIABLES_OPERATION:
+            for (size_t i = 0; i < sizeof(constant_foldable_variables_operations) / sizeof(StackOperationVariablesFunction); ++i) {
+                if (operation.variables_operation == constant_foldable_variables_operations[i]) return 1;
+            }
+            return 0;
+        case NO_OPERATION:
+        default:
+            return 0;
+    }
+}
+
+int is_division_operation(StackOperation operation) {
+    switch (operation.type) {
+        case SIMPLE_OPERATION:
+            return operation.operation_function == slash_symbol_operation;
+        case VARIABLES_OPERATION:
+            return operation.variables_operation == parentheses_symbol_operation;
+        case NO_OPERATION:
+        default:
+            return 0;
+    }
 }
 
 void execute_operation(StackOperation operation, Stack *stack, StackElement *variables) {
@@ -84,6 +246,7 @@ void execute_operation(StackOperation operation, Stack *stack, StackElement *var
         case VARIABLES_OPERATION:
             operation.variables_operation(stack, variables);
             return;
+        case NO_OPERATION:
         default:
             return;
     }
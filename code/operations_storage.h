@@ -3,6 +3,8 @@
  * @brief Responsável por guardar as operações possíveis na stack
  */
 
+#pragma once
+
 #include "stack.h"
 
 /**
@@ -19,18 +21,30 @@ typedef void (*StackOperationVariablesFunction)(Stack *, StackElement *);
  * @brief Tipos de operações possíveis (Operação recebe variaveis globais ou não)
  */
 typedef enum {
+    /** @brief Não existe operação (valor das posições vazias das tabelas de operações) */
+    NO_OPERATION,
     /** @brief Recebe apenas a stack como parametro */
     SIMPLE_OPERATION,
     /** @brief Recebe a stack e as variáveis globais como parametro */
     VARIABLES_OPERATION
 } OperationType;
 
+/**
+ * @brief Valor de StackOperation.inputs e StackOperation.outputs das operações cujo número de elementos retirados ou
+ * deixados na stack depende dos tipos dos elementos (por exemplo ( e ) em arrays)
+ */
+#define UNKNOWN_STACK_EFFECT (-1)
+
 /**
  * @brief Struct para guardar informação sobre a função da operação
  */
 typedef struct {
     /** @brief Tipo da operação */
     OperationType type;
+    /** @brief Número de elementos retirados da stack, ou UNKNOWN_STACK_EFFECT */
+    signed char inputs;
+    /** @brief Número de elementos deixados na stack, ou UNKNOWN_STACK_EFFECT */
+    signed char outputs;
     /** @brief Union dos possíveis tipos de operaçã */
     union {
         /** @brief Pointer para função que recebe apenas stack como parametro */
@@ -41,14 +55,12 @@ typedef struct {
 } StackOperation;
 
 /**
- * @brief Struct para juntar o operador e a operação num só
+ * @brief Procura a correspondente operação StackOperation do @param{op} operador em tempo constante.
+ * @param op operador
+ * @param to pointer para onde a operação encontrada irá ficar
+ * @return 1 se o operador tem operação correspondente, 0 caso contrário
  */
-typedef struct {
-    /** @brief Operador string */
-    char operator[5];
-    /** @brief Operação */
-    StackOperation operation;
-} StackOperationTableEntry;
+int find_operation(char op[], StackOperation *to);
 
 /**
  * @brief Procura a correspondente operação StackOperation do @param{op} operador.
@@ -56,6 +68,49 @@ typedef struct {
  */
 StackOperation get_operation(char op[]);
 
+/**
+ * @brief Retorna o nome da função de uma operação (usado pelo transpilador para gerar chamadas diretas)
+ * @param operation A operação
+ * @return O nome da função, NULL se a operação não está nas tabelas de operações
+ */
+const char *get_operation_name(StackOperation operation);
+
+/**
+ * @brief Verifica se uma operação lê do stdin
+ * @param operation A operação
+ * @return 1 se a operação lê input da consola, 0 caso contrário
+ */
+int reads_input(StackOperation operation);
+
+/**
+ * @brief Verifica se uma operação escreve no stdout
+ * @param operation A operação
+ * @return 1 se a operação escreve na consola, 0 caso contrário
+ */
+int writes_output(StackOperation operation);
+
+/**
+ * @brief Verifica se uma operação tem efeitos fora da stack (input/output)
+ * @param operation A operação
+ * @return 1 se a operação lê ou escreve na consola, 0 caso contrário
+ */
+int has_side_effects(StackOperation operation);
+
+/**
+ * @brief Verifica se uma operação aplicada apenas a números (longs, doubles e chars) depende só deles e pode ser
+ * calculada ao compilar (aritmética, comparações, lógica, bitwise, ( ) e conversões c i f)
+ * @param operation A operação
+ * @return 1 se a operação pode ser calculada ao compilar, 0 caso contrário
+ */
+int is_constant_foldable(StackOperation operation);
+
+/**
+ * @brief Verifica se uma operação aplicada a números divide pelo último elemento (/ e %)
+ * @param operation A operação
+ * @return 1 se a operação divide, 0 caso contrário
+ */
+int is_division_operation(StackOperation operation);
+
 /**
  * @brief Executa a operação pretendida na stack
  * @param operation A operação
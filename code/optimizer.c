@@ -0,0 +1,312 @@
+/**
+ * @file optimizer.c
+ * @brief Implementação das otimizações peephole dos blocos compilados
+ *
+ * As instruções são copiadas uma a uma para o fim das instruções já otimizadas (no mesmo array) e depois de cada
+ * cópia o fim é reescrito enquanto alguma regra se aplicar, por isso as regras encadeiam-se
+ * (ex: 60 60 * 24 * -> 3600 24 * -> 86400).
+ */
+
+#include "optimizer.h"
+#include "operations.h"
+#include "logica.h"
+#include "logger.h"
+
+/**
+ * @brief Contadores de todos os blocos otimizados (atualizados atomicamente no fim de cada bloco)
+ */
+static OptimizerStats optimizer_stats;
+
+/**
+ * @brief Verifica se uma instrução executa uma operação
+ * @param instruction target
+ * @return 1 se é uma operação, 0 caso contrário
+ */
+static int is_operation_instruction(const Instruction *instruction) {
+    return instruction->type == SIMPLE_OPERATION_INSTRUCTION || instruction->type == VARIABLES_OPERATION_INSTRUCTION;
+}
+
+/**
+ * @brief Verifica se uma instrução executa uma operação simples
+ * @param instruction target
+ * @param operation_function função da operação
+ * @return 1 se a instrução executa a operação, 0 caso contrário
+ */
+static int is_simple_operation(const Instruction *instruction, StackOperationFunction operation_function) {
+    return instruction->type == SIMPLE_OPERATION_INSTRUCTION
+           && instruction->operation.operation_function == operation_function;
+}
+
+/**
+ * @brief Verifica se uma instrução faz push de um número (long, double ou char)
+ * @param instruction target
+ * @return 1 se a instrução faz push de um número, 0 caso contrário
+ */
+static int is_number_literal(const Instruction *instruction) {
+    if (instruction->type != PUSH_LITERAL_INSTRUCTION) return 0;
+
+    switch (instruction->literal.type) {
+        case LONG_TYPE:
+        case DOUBLE_TYPE:
+        case CHAR_TYPE:
+            return 1;
+        case STRING_TYPE:
+        case ARRAY_TYPE:
+        case BLOCK_TYPE:
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Calcula uma operação aplicada a números literais executando-a numa stack auxiliar
+ * @param operation operação (ver is_constant_foldable)
+ * @param operands instruções que fazem push dos números (ver is_number_literal)
+ * @param operand_count número de operandos
+ * @param result pointer para onde o resultado irá ficar
+ * @return 1 se o resultado é um único número, 0 caso contrário (a operação não pode ser calculada ao compilar)
+ */
+static int try_to_fold(StackOperation operation, const Instruction *operands, int operand_count,
+                       StackElement *result) {
+    if (is_division_operation(operation)) {
+        // As divisões de longs por 0 e de LONG_MIN por -1 abortam o programa, só são feitas quando executadas
+        StackElement divisor = operands[operand_count - 1].literal;
+        long long_divisor = get_element_as_long(&divisor);
+        if (long_divisor == 0 || long_divisor == -1) return 0;
+    }
+
+    Stack *stack = create_stack(operand_count);
+    for (int i = 0; i < operand_count; ++i) {
+        push(stack, operands[i].literal);
+    }
+
+    execute_operation(operation, stack, NULL);
+
+    int is_number = length(stack) == 1 && (peek(stack).type == LONG_TYPE || peek(stack).type == DOUBLE_TYPE
+                                           || peek(stack).type == CHAR_TYPE);
+    if (is_number) *result = pop(stack);
+
+    free_stack(stack);
+    return is_number;
+}
+
+/**
+ * @brief Tenta calcular a operação do fim das instruções otimizadas aplicada aos literais que a precedem
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @param stats contadores do bloco
+ * @return 1 se a operação foi calculada, 0 caso contrário
+ */
+static int fold_constant_operation(Instruction *instructions, int *count, OptimizerStats *stats) {
+    Instruction *last = &instructions[*count - 1];
+    if (!is_constant_foldable(last->operation)) return 0;
+
+    int operand_count = last->operation.inputs == 2 ? 2 : 1;
+    if (last->operation.inputs != operand_count && last->operation.inputs != UNKNOWN_STACK_EFFECT) return 0;
+    if (*count <= operand_count) return 0;
+
+    Instruction *operands = last - operand_count;
+    for (int i = 0; i < operand_count; ++i) {
+        if (!is_number_literal(&operands[i])) return 0;
+    }
+
+    StackElement result;
+    if (!try_to_fold(last->operation, operands, operand_count, &result)) return 0;
+
+    operands[0].type = PUSH_LITERAL_INSTRUCTION;
+    operands[0].literal = result;
+    *count -= operand_count;
+
+    stats->folded++;
+    return 1;
+}
+
+/**
+ * @brief Reescreve o fim das instruções otimizadas quando acaba num ? depois de literais: com três literais fica
+ * apenas o literal escolhido, com dois literais fica uma SELECT_LITERAL_INSTRUCTION
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @param stats contadores do bloco
+ * @return 1 se as instruções foram reescritas, 0 caso contrário
+ */
+static int optimize_select(Instruction *instructions, int *count, OptimizerStats *stats) {
+    if (*count < 3) return 0;
+
+    Instruction *literals = &instructions[*count - 3];
+    if (literals[0].type != PUSH_LITERAL_INSTRUCTION || literals[1].type != PUSH_LITERAL_INSTRUCTION) return 0;
+
+    if (*count >= 4 && literals[-1].type == PUSH_LITERAL_INSTRUCTION) {
+        Instruction *condition = &literals[-1];
+        int chosen = is_truthy(&condition->literal) ? 0 : 1;
+
+        free_immortal_element(condition->literal);
+        free_immortal_element(literals[1 - chosen].literal);
+        condition->literal = literals[chosen].literal;
+        *count -= 3;
+
+        stats->folded++;
+        return 1;
+    }
+
+    StackElement if_literal = literals[0].literal;
+    StackElement else_literal = literals[1].literal;
+
+    literals[0].type = SELECT_LITERAL_INSTRUCTION;
+    literals[0].select_literals[0] = if_literal;
+    literals[0].select_literals[1] = else_literal;
+    *count -= 2;
+
+    stats->fused++;
+    return 1;
+}
+
+/**
+ * @brief Remove o fim das instruções otimizadas quando não tem efeito: um push (de um literal, variável ou
+ * duplicado) seguido de ;, ou \ \
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @return 1 se as instruções foram removidas, 0 caso contrário
+ */
+static int remove_no_op(Instruction *instructions, int *count) {
+    if (*count < 2) return 0;
+
+    Instruction *last = &instructions[*count - 1];
+    Instruction *previous = &instructions[*count - 2];
+
+    if (is_simple_operation(last, pop_operation)) {
+        switch (previous->type) {
+            case PUSH_LITERAL_INSTRUCTION:
+                free_immortal_element(previous->literal);
+                break;
+            case PUSH_VARIABLE_INSTRUCTION:
+                break;
+            case SIMPLE_OPERATION_INSTRUCTION:
+                if (!is_simple_operation(previous, duplicate_operation)) return 0;
+                break;
+            case PUSH_ARRAY_INSTRUCTION:
+            case SET_VARIABLE_INSTRUCTION:
+            case VARIABLES_OPERATION_INSTRUCTION:
+            case PUSH_LITERAL_OPERATION_INSTRUCTION:
+            case DUPLICATE_OPERATION_INSTRUCTION:
+            case SELECT_LITERAL_INSTRUCTION:
+            case UNKNOWN_OPERATION_INSTRUCTION:
+            case RETURN_INSTRUCTION:
+            default:
+                return 0;
+        }
+    } else if (!is_simple_operation(last, swap_last_two_operation)
+               || !is_simple_operation(previous, swap_last_two_operation)) {
+        return 0;
+    }
+
+    *count -= 2;
+    return 1;
+}
+
+/**
+ * @brief Substitui um número seguido de _ no fim das instruções otimizadas por dois push do número, para poder ser
+ * calculado com a operação seguinte (ex: 5 _ * -> 5 5 * -> 25)
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @return 1 se a instrução foi substituida, 0 caso contrário
+ */
+static int duplicate_number_literal(Instruction *instructions, const int *count) {
+    if (*count < 2) return 0;
+
+    Instruction *last = &instructions[*count - 1];
+    Instruction *previous = &instructions[*count - 2];
+    if (!is_number_literal(previous) || !is_simple_operation(last, duplicate_operation)) return 0;
+
+    *last = *previous;
+    return 1;
+}
+
+/**
+ * @brief Junta a operação do fim das instruções otimizadas com a instrução anterior numa superinstrução (push de
+ * um literal e operação, ou _ e operação)
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @param stats contadores do bloco
+ * @return 1 se as instruções foram juntas, 0 caso contrário
+ */
+static int fuse_operation(Instruction *instructions, int *count, OptimizerStats *stats) {
+    if (*count < 2) return 0;
+
+    Instruction *last = &instructions[*count - 1];
+    Instruction *previous = &instructions[*count - 2];
+
+    StackOperation operation = last->operation;
+
+    if (previous->type == PUSH_LITERAL_INSTRUCTION) {
+        StackElement literal = previous->literal;
+        previous->type = PUSH_LITERAL_OPERATION_INSTRUCTION;
+        previous->literal_operation.literal = literal;
+        previous->literal_operation.operation = operation;
+    } else if (is_simple_operation(previous, duplicate_operation)) {
+        previous->type = DUPLICATE_OPERATION_INSTRUCTION;
+        previous->operation = operation;
+    } else {
+        return 0;
+    }
+
+    *count -= 1;
+
+    stats->fused++;
+    return 1;
+}
+
+/**
+ * @brief Aplica a primeira regra que reescreve o fim das instruções otimizadas
+ * @param instructions instruções otimizadas
+ * @param count pointer para o número de instruções otimizadas
+ * @param stats contadores do bloco
+ * @return 1 se alguma regra foi aplicada, 0 caso contrário
+ */
+static int optimize_tail(Instruction *instructions, int *count, OptimizerStats *stats) {
+    if (*count == 0 || !is_operation_instruction(&instructions[*count - 1])) return 0;
+
+    if (is_simple_operation(&instructions[*count - 1], if_then_else_operation)
+        && optimize_select(instructions, count, stats)) {
+        return 1;
+    }
+
+    return fold_constant_operation(instructions, count, stats)
+           || remove_no_op(instructions, count)
+           || duplicate_number_literal(instructions, count)
+           || fuse_operation(instructions, count, stats);
+}
+
+void optimize_compiled_block(CompiledBlock *block) {
+    Instruction *instructions = block->instructions;
+    OptimizerStats stats = {0, 0, 0, 0};
+    int count = 0;
+
+    // Só as instruções antes da RETURN_INSTRUCTION são otimizadas
+    for (int i = 0; i < block->length - 1; ++i) {
+        instructions[count++] = instructions[i];
+        while (optimize_tail(instructions, &count, &stats));
+    }
+    instructions[count++] = instructions[block->length - 1];
+
+    PRINT_DEBUG("Optimized block: %d -> %d instructions\n", block->length, count)
+
+    stats.instructions = (unsigned long) block->length;
+    stats.removed = (unsigned long) (block->length - count);
+    block->length = count;
+
+    __atomic_fetch_add(&optimizer_stats.instructions, stats.instructions, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&optimizer_stats.removed, stats.removed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&optimizer_stats.folded, stats.folded, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&optimizer_stats.fused, stats.fused, __ATOMIC_RELAXED);
+}
+
+OptimizerStats get_optimizer_stats(void) {
+    OptimizerStats stats = {
+            __atomic_load_n(&optimizer_stats.instructions, __ATOMIC_RELAXED),
+            __atomic_load_n(&optimizer_stats.removed, __ATOMIC_RELAXED),
+            __atomic_load_n(&optimizer_stats.folded, __ATOMIC_RELAXED),
+            __atomic_load_n(&optimizer_stats.fused, __ATOMIC_RELAXED)
+    };
+
+    return stats;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file optimizer.h
+ * @brief Otimizações peephole dos blocos compilados: calcula as expressões constantes (ex: 60 60 *), remove
+ * sequências sem efeito (ex: \ \, 1 ;) e junta sequências frequentes em superinstruções (ex: 1 +, _ *, {a} {b} ?)
+ */
+
+#pragma once
+
+#include "compiler.h"
+
+/**
+ * Contadores do optimizer
+ */
+typedef struct {
+    /** Número de instruções antes das otimizações */
+    unsigned long instructions;
+    /** Número de instruções removidas */
+    unsigned long removed;
+    /** Número de operações calculadas ao compilar */
+    unsigned long folded;
+    /** Número de superinstruções criadas */
+    unsigned long fused;
+} OptimizerStats;
+
+/**
+ * Otimiza as instruções de um bloco acabado de compilar (antes de prepare_compiled_block).
+ * As operações calculadas ao compilar são executadas com as mesmas funções que as executam no programa, por isso o
+ * resultado é o mesmo. Os literais removidos são libertados.
+ * @param block bloco compilado (acaba com a RETURN_INSTRUCTION)
+ */
+void optimize_compiled_block(CompiledBlock *block);
+
+/**
+ * Retorna os contadores do optimizer de todos os blocos otimizados
+ * @return Os contadores
+ */
+OptimizerStats get_optimizer_stats(void);
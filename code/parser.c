@@ -6,13 +6,6 @@
 #include <ctype.h>
 #include <string.h>
 #include "parser.h"
-#include "logger.h"
-#include "conversions.h"
-#include "variable_operations.h"
-#include "operations_storage.h"
-#include "string_operations.h"
-#include "array_operations.h"
-#include "block_operations.h"
 
 /**
  * @brief O parse state atual (O que é que está a dar parse)
@@ -28,56 +21,6 @@ enum parseState {
     PARSING_INSIDE_CURLY_BRACKETS
 };
 
-void parse_word(Stack *stack, StackElement *variables, char word[]) {
-    PRINT_DEBUG("Parsing: '%s'\n", word)
-
-    long l;
-    double d;
-
-    if (parse_long(word, &l)) {
-        PRINT_DEBUG("Pushing long: %ld\n", l)
-        push_long(stack, l);
-        return;
-    }
-
-    if (parse_double(word, &d)) {
-        PRINT_DEBUG("Pushing double: %g\n", d)
-        push_double(stack, d);
-        return;
-    }
-
-    if (parse_push_variable(stack, variables, word)) {
-        PRINT_DEBUG("Pushing variable '%s'\n", word)
-        return;
-    }
-
-    if (parse_set_variable(stack, variables, word)) {
-        PRINT_DEBUG("Setting variable '%s'\n", word)
-        return;
-    }
-
-    if (parse_string(stack, word)) {
-        PRINT_DEBUG("Pushing string '%s'\n", word + 1)
-        return;
-    }
-
-    if (parse_array(stack, variables, word)) {
-        PRINT_DEBUG("Pushing array '%s'\n", word + 1)
-        return;
-    }
-
-    if (try_to_parse_block(stack, word)) {
-        PRINT_DEBUG("Pushing block '{%s}'\n", word + 1)
-        return;
-    }
-
-    PRINT_DEBUG("Parsed symbol: %s\n", word)
-
-    StackOperation operation = get_operation(word);
-
-    execute_operation(operation, stack, variables);
-}
-
 /**
  * @brief Retorna o novo state do parser conforme um caractere
  * @param c o caractere
@@ -141,12 +84,12 @@ int get_new_bracket_count(int bracket_count, char current_char, char open_bracke
     return bracket_count;
 }
 
-void tokenize_and_parse(Stack *stack, StackElement *variables, char *input) {
+void tokenize(char *input, WordFunction word_function, void *data) {
     enum parseState state = PARSING_NORMAL_TEXT;
 
     size_t input_length = strlen(input);
 
-    char word[input_length];
+    char word[input_length + 1];
 
     int current_word_index = 0;
 
@@ -163,7 +106,7 @@ void tokenize_and_parse(Stack *stack, StackElement *variables, char *input) {
                 current_word_index = 0;
 
                 if (*word) {
-                    parse_word(stack, variables, word);
+                    word_function(word, data);
                 }
             } else if (was_success_set_state_from_open_char(current_char, &state)) {
                 bracket_count++;
@@ -1,25 +1,19 @@
 /**
  * @file parser.h
- * @brief Responsável de converter o input para objetos do programa
+ * @brief Responsável de separar o input em words
  */
 
 #pragma once
 
-#include "stack.h"
-
 /**
- * @brief Separa a string de input em espaços, strings, arrays e blocos e executa função parse_word nessa word separada
- * @param stack target
- * @param variables variáveis
- * @param input input bruto
+ * @brief Função chamada para cada word separada pelo tokenizer
  */
-void tokenize_and_parse(Stack *stack, StackElement *variables, char *input);
+typedef void (*WordFunction)(char *word, void *data);
 
 /**
- * @brief Dá parse_word a uma word.
- * @brief Transforma a word no seu devido valor e coloca-o na stack, ou executa-o se for uma operação.
- * @param stack target
- * @param variables variáveis
- * @param word word para transformar
+ * @brief Separa a string de input em espaços, strings, arrays e blocos e chama @param{word_function} para cada word separada
+ * @param input input bruto
+ * @param word_function função a chamar para cada word
+ * @param data dados passados à @param{word_function}
  */
-void parse_word(Stack *stack, StackElement *variables, char word[]);
+void tokenize(char *input, WordFunction word_function, void *data);
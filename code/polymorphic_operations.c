@@ -10,13 +10,11 @@
 #include "block_operations.h"
 
 void asterisk_operation(Stack *stack, StackElement *variables) {
-    ElementType left_element_type = get(stack, 1).type;
-
-    if (peek(stack).type == BLOCK_TYPE) {
+    if (is_element_type(stack, 0, BLOCK_TYPE)) {
         fold_operation(stack, variables);
-    } else if (left_element_type == ARRAY_TYPE) {
+    } else if (is_element_type(stack, 1, ARRAY_TYPE)) {
         repeat_array_operation(stack);
-    } else if (left_element_type == STRING_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE)) {
         repeat_string_operation(stack);
     } else {
         mult_operation(stack);
@@ -24,12 +22,9 @@ void asterisk_operation(Stack *stack, StackElement *variables) {
 }
 
 void tilde_operation(Stack *stack, StackElement *variables) {
-    StackElement element = peek(stack);
-    ElementType element_type = element.type;
-
-    if (element_type == ARRAY_TYPE) {
+    if (is_element_type(stack, 0, ARRAY_TYPE)) {
         push_all_elements_from_array_operation(stack);
-    } else if (element_type == BLOCK_TYPE) {
+    } else if (is_element_type(stack, 0, BLOCK_TYPE)) {
         execute_block_operation(stack, variables);
     } else {
         not_bitwise_operation(stack);
@@ -37,12 +32,9 @@ void tilde_operation(Stack *stack, StackElement *variables) {
 }
 
 void lesser_than_symbol_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == ARRAY_TYPE && right_element_type == LONG_TYPE) {
+    if (is_element_type(stack, 1, ARRAY_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         take_first_n_elements_from_array_operation(stack);
-    } else if (left_element_type == STRING_TYPE && right_element_type == LONG_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         take_first_n_elements_from_string_operation(stack);
     } else {
         lesser_than_operation(stack);
@@ -50,12 +42,9 @@ void lesser_than_symbol_operation(Stack *stack) {
 }
 
 void bigger_than_symbol_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == ARRAY_TYPE && right_element_type == LONG_TYPE) {
+    if (is_element_type(stack, 1, ARRAY_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         take_last_n_elements_from_array_operation(stack);
-    } else if (left_element_type == STRING_TYPE && right_element_type == LONG_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         take_last_n_elements_from_string_operation(stack);
     } else {
         bigger_than_operation(stack);
@@ -63,11 +52,9 @@ void bigger_than_symbol_operation(Stack *stack) {
 }
 
 void open_parentheses_operation(Stack *stack) {
-    ElementType element_type = peek(stack).type;
-
-    if (element_type == ARRAY_TYPE) {
+    if (is_element_type(stack, 0, ARRAY_TYPE)) {
         remove_first_element_from_array_operation(stack);
-    } else if (element_type == STRING_TYPE) {
+    } else if (is_element_type(stack, 0, STRING_TYPE)) {
         remove_first_element_from_string_operation(stack);
     } else {
         decrement_operation(stack);
@@ -75,11 +62,9 @@ void open_parentheses_operation(Stack *stack) {
 }
 
 void close_parentheses_operation(Stack *stack) {
-    ElementType element_type = peek(stack).type;
-
-    if (element_type == ARRAY_TYPE) {
+    if (is_element_type(stack, 0, ARRAY_TYPE)) {
         remove_last_element_from_array_operation(stack);
-    } else if (element_type == STRING_TYPE) {
+    } else if (is_element_type(stack, 0, STRING_TYPE)) {
         remove_last_element_from_string_operation(stack);
     } else {
         increment_operation(stack);
@@ -87,12 +72,9 @@ void close_parentheses_operation(Stack *stack) {
 }
 
 void equal_symbol_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == ARRAY_TYPE && right_element_type == LONG_TYPE) {
+    if (is_element_type(stack, 1, ARRAY_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         get_element_from_index_array_operation(stack);
-    } else if (left_element_type == STRING_TYPE && right_element_type == LONG_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE) && is_element_type(stack, 0, LONG_TYPE)) {
         get_element_from_index_string_operation(stack);
     } else {
         is_equal_operation(stack);
@@ -100,9 +82,7 @@ void equal_symbol_operation(Stack *stack) {
 }
 
 void slash_symbol_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-
-    if (left_element_type == STRING_TYPE) {
+    if (is_element_type(stack, 1, STRING_TYPE)) {
         separate_string_by_substring_operation(stack);
     } else {
         div_operation(stack);
@@ -110,10 +90,8 @@ void slash_symbol_operation(Stack *stack) {
 }
 
 void hashtag_symbol_operation(Stack *stack) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == STRING_TYPE && (right_element_type == STRING_TYPE || right_element_type == CHAR_TYPE)) {
+    if (is_element_type(stack, 1, STRING_TYPE)
+        && (is_element_type(stack, 0, STRING_TYPE) || is_element_type(stack, 0, CHAR_TYPE))) {
         search_substring_in_string_operation(stack);
     } else {
         exponential_operation(stack);
@@ -121,12 +99,9 @@ void hashtag_symbol_operation(Stack *stack) {
 }
 
 void parentheses_symbol_operation(Stack *stack, StackElement *variables) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == ARRAY_TYPE && right_element_type == BLOCK_TYPE) {
+    if (is_element_type(stack, 1, ARRAY_TYPE) && is_element_type(stack, 0, BLOCK_TYPE)) {
         map_block_array_operation(stack, variables);
-    } else if (left_element_type == STRING_TYPE && right_element_type == BLOCK_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE) && is_element_type(stack, 0, BLOCK_TYPE)) {
         map_block_string_operation(stack, variables);
     } else {
         modulo_operation(stack);
@@ -134,12 +109,9 @@ void parentheses_symbol_operation(Stack *stack, StackElement *variables) {
 }
 
 void comma_symbol_operation(Stack *stack, StackElement *variables) {
-    ElementType left_element_type = get(stack, 1).type;
-    ElementType right_element_type = peek(stack).type;
-
-    if (left_element_type == ARRAY_TYPE && right_element_type == BLOCK_TYPE) {
+    if (is_element_type(stack, 1, ARRAY_TYPE) && is_element_type(stack, 0, BLOCK_TYPE)) {
         filter_block_array_operation(stack, variables);
-    } else if (left_element_type == STRING_TYPE && right_element_type == BLOCK_TYPE) {
+    } else if (is_element_type(stack, 1, STRING_TYPE) && is_element_type(stack, 0, BLOCK_TYPE)) {
         filter_block_string_operation(stack, variables);
     } else {
         size_range_operation(stack);
@@ -147,10 +119,12 @@ void comma_symbol_operation(Stack *stack, StackElement *variables) {
 }
 
 void dollar_symbol_operation(Stack *stack, StackElement *variables) {
-    ElementType right_element_type = peek(stack).type;
-
-    if (right_element_type == BLOCK_TYPE) {
+    if (is_element_type(stack, 0, BLOCK_TYPE)) {
         sort_block_array_operation(stack, variables);
+    } else if (is_element_type(stack, 0, ARRAY_TYPE)) {
+        sort_array_operation(stack);
+    } else if (is_element_type(stack, 0, STRING_TYPE)) {
+        sort_string_operation(stack);
     } else {
         copy_nth_element_operation(stack);
     }
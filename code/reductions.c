@@ -0,0 +1,397 @@
+/**
+ * @file reductions.c
+ * @brief Implementação das reduções de arrays de longs e doubles
+ */
+
+#include "reductions.h"
+#include "logger.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+/**
+ * Compila os kernels SIMD: SSE2 faz parte de todos os processadores x86-64, AVX2 é usado quando o processador o
+ * suporta (verificado com o CPUID em tempo de execução)
+ */
+#define X86_REDUCTIONS 1
+#endif
+
+/**
+ * @brief Aplica o operador a dois longs
+ * @param fold_operator operador
+ * @param a valor da esquerda
+ * @param b valor da direita
+ * @return O resultado
+ */
+static long combine_longs(FoldOperator fold_operator, long a, long b) {
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            return (long) ((unsigned long) a + (unsigned long) b);
+        case MULTIPLY_FOLD_OPERATOR:
+            return (long) ((unsigned long) a * (unsigned long) b);
+        case MAX_FOLD_OPERATOR:
+            return a < b ? b : a;
+        case MIN_FOLD_OPERATOR:
+            return a > b ? b : a;
+        case AND_FOLD_OPERATOR:
+            return a & b;
+        case OR_FOLD_OPERATOR:
+            return a | b;
+        case XOR_FOLD_OPERATOR:
+            return a ^ b;
+        case NO_FOLD_OPERATOR:
+        default:
+            PANIC("Trying to reduce longs without an associative operator (%d)", fold_operator)
+    }
+}
+
+/**
+ * @brief Aplica o operador a dois doubles, com as mesmas comparações que e> e e<
+ * @param fold_operator operador
+ * @param a valor da esquerda
+ * @param b valor da direita
+ * @return O resultado
+ */
+static double combine_doubles(FoldOperator fold_operator, double a, double b) {
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            return a + b;
+        case MULTIPLY_FOLD_OPERATOR:
+            return a * b;
+        case MAX_FOLD_OPERATOR:
+            return a < b ? b : a;
+        case MIN_FOLD_OPERATOR:
+            return a > b ? b : a;
+        case AND_FOLD_OPERATOR:
+        case OR_FOLD_OPERATOR:
+        case XOR_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            PANIC("Trying to reduce doubles without an associative operator (%d)", fold_operator)
+    }
+}
+
+/**
+ * @brief Reduz longs da esquerda para a direita sem SIMD
+ * @param fold_operator operador
+ * @param values os longs
+ * @param count número de longs (pelo menos um)
+ * @return O resultado
+ */
+static long reduce_longs_scalar(FoldOperator fold_operator, const long *values, size_t count) {
+    unsigned long result = (unsigned long) values[0];
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result += (unsigned long) values[i];
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result *= (unsigned long) values[i];
+            break;
+        case AND_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result &= (unsigned long) values[i];
+            break;
+        case OR_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result |= (unsigned long) values[i];
+            break;
+        case XOR_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result ^= (unsigned long) values[i];
+            break;
+        case MAX_FOLD_OPERATOR:
+        case MIN_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            for (size_t i = 1; i < count; ++i) {
+                result = (unsigned long) combine_longs(fold_operator, (long) result, values[i]);
+            }
+    }
+
+    return (long) result;
+}
+
+double reduce_doubles(FoldOperator fold_operator, const double *values, size_t count) {
+    double result = values[0];
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result += values[i];
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (size_t i = 1; i < count; ++i) result *= values[i];
+            break;
+        case MAX_FOLD_OPERATOR:
+        case MIN_FOLD_OPERATOR:
+        case AND_FOLD_OPERATOR:
+        case OR_FOLD_OPERATOR:
+        case XOR_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            for (size_t i = 1; i < count; ++i) result = combine_doubles(fold_operator, result, values[i]);
+    }
+
+    return result;
+}
+
+#ifdef X86_REDUCTIONS
+
+/**
+ * @brief Multiplica os longs de dois vetores SSE2 (módulo 2^64), a partir dos produtos de 32 bits
+ * @param a primeiro vetor
+ * @param b segundo vetor
+ * @return O produto
+ */
+static inline __m128i multiply_longs_sse2(__m128i a, __m128i b) {
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+
+    return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+}
+
+/**
+ * @brief Reduz longs com vetores SSE2 de 2 longs (o máximo e o mínimo são escalares, SSE2 não compara longs)
+ * @param fold_operator operador
+ * @param values os longs
+ * @param count número de longs (pelo menos um)
+ * @return O resultado
+ */
+static long reduce_longs_sse2(FoldOperator fold_operator, const long *values, size_t count) {
+    if (count < 4) return reduce_longs_scalar(fold_operator, values, count);
+
+    __m128i result = _mm_loadu_si128((const __m128i *) values);
+    size_t i = 2;
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_add_epi64(result, _mm_loadu_si128((const __m128i *) &values[i]));
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) {
+                result = multiply_longs_sse2(result, _mm_loadu_si128((const __m128i *) &values[i]));
+            }
+            break;
+        case AND_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_and_si128(result, _mm_loadu_si128((const __m128i *) &values[i]));
+            break;
+        case OR_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_or_si128(result, _mm_loadu_si128((const __m128i *) &values[i]));
+            break;
+        case XOR_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_xor_si128(result, _mm_loadu_si128((const __m128i *) &values[i]));
+            break;
+        case MAX_FOLD_OPERATOR:
+        case MIN_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            return reduce_longs_scalar(fold_operator, values, count);
+    }
+
+    long lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, result);
+
+    long reduced = combine_longs(fold_operator, lanes[0], lanes[1]);
+    for (; i < count; ++i) reduced = combine_longs(fold_operator, reduced, values[i]);
+
+    return reduced;
+}
+
+/**
+ * @brief Multiplica os longs de dois vetores AVX2 (módulo 2^64), a partir dos produtos de 32 bits
+ * @param a primeiro vetor
+ * @param b segundo vetor
+ * @return O produto
+ */
+__attribute__((target("avx2")))
+static inline __m256i multiply_longs_avx2(__m256i a, __m256i b) {
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+/**
+ * @brief Reduz longs com vetores AVX2 de 4 longs
+ * @param fold_operator operador
+ * @param values os longs
+ * @param count número de longs (pelo menos um)
+ * @return O resultado
+ */
+__attribute__((target("avx2")))
+static long reduce_longs_avx2(FoldOperator fold_operator, const long *values, size_t count) {
+    if (count < 8) return reduce_longs_scalar(fold_operator, values, count);
+
+    __m256i result = _mm256_loadu_si256((const __m256i *) values);
+    size_t i = 4;
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                result = _mm256_add_epi64(result, _mm256_loadu_si256((const __m256i *) &values[i]));
+            }
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                result = multiply_longs_avx2(result, _mm256_loadu_si256((const __m256i *) &values[i]));
+            }
+            break;
+        case MAX_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                __m256i current = _mm256_loadu_si256((const __m256i *) &values[i]);
+                result = _mm256_blendv_epi8(result, current, _mm256_cmpgt_epi64(current, result));
+            }
+            break;
+        case MIN_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                __m256i current = _mm256_loadu_si256((const __m256i *) &values[i]);
+                result = _mm256_blendv_epi8(result, current, _mm256_cmpgt_epi64(result, current));
+            }
+            break;
+        case AND_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                result = _mm256_and_si256(result, _mm256_loadu_si256((const __m256i *) &values[i]));
+            }
+            break;
+        case OR_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                result = _mm256_or_si256(result, _mm256_loadu_si256((const __m256i *) &values[i]));
+            }
+            break;
+        case XOR_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                result = _mm256_xor_si256(result, _mm256_loadu_si256((const __m256i *) &values[i]));
+            }
+            break;
+        case NO_FOLD_OPERATOR:
+        default:
+            return reduce_longs_scalar(fold_operator, values, count);
+    }
+
+    long lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, result);
+
+    long reduced = reduce_longs_scalar(fold_operator, lanes, 4);
+    for (; i < count; ++i) reduced = combine_longs(fold_operator, reduced, values[i]);
+
+    return reduced;
+}
+
+/**
+ * @brief Reduz doubles com vetores SSE2 de 2 doubles
+ * @param fold_operator operador
+ * @param values os doubles
+ * @param count número de doubles (pelo menos um)
+ * @return O resultado
+ */
+static double reduce_doubles_sse2(FoldOperator fold_operator, const double *values, size_t count) {
+    if (count < 4) return reduce_doubles(fold_operator, values, count);
+
+    __m128d result = _mm_loadu_pd(values);
+    size_t i = 2;
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_add_pd(result, _mm_loadu_pd(&values[i]));
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) result = _mm_mul_pd(result, _mm_loadu_pd(&values[i]));
+            break;
+        case MAX_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) {
+                __m128d current = _mm_loadu_pd(&values[i]);
+                __m128d mask = _mm_cmplt_pd(result, current);
+                result = _mm_or_pd(_mm_and_pd(mask, current), _mm_andnot_pd(mask, result));
+            }
+            break;
+        case MIN_FOLD_OPERATOR:
+            for (; i + 2 <= count; i += 2) {
+                __m128d current = _mm_loadu_pd(&values[i]);
+                __m128d mask = _mm_cmpgt_pd(result, current);
+                result = _mm_or_pd(_mm_and_pd(mask, current), _mm_andnot_pd(mask, result));
+            }
+            break;
+        case AND_FOLD_OPERATOR:
+        case OR_FOLD_OPERATOR:
+        case XOR_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            return reduce_doubles(fold_operator, values, count);
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, result);
+
+    double reduced = combine_doubles(fold_operator, lanes[0], lanes[1]);
+    for (; i < count; ++i) reduced = combine_doubles(fold_operator, reduced, values[i]);
+
+    return reduced;
+}
+
+/**
+ * @brief Reduz doubles com vetores AVX2 de 4 doubles
+ * @param fold_operator operador
+ * @param values os doubles
+ * @param count número de doubles (pelo menos um)
+ * @return O resultado
+ */
+__attribute__((target("avx2")))
+static double reduce_doubles_avx2(FoldOperator fold_operator, const double *values, size_t count) {
+    if (count < 8) return reduce_doubles(fold_operator, values, count);
+
+    __m256d result = _mm256_loadu_pd(values);
+    size_t i = 4;
+
+    switch (fold_operator) {
+        case ADD_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) result = _mm256_add_pd(result, _mm256_loadu_pd(&values[i]));
+            break;
+        case MULTIPLY_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) result = _mm256_mul_pd(result, _mm256_loadu_pd(&values[i]));
+            break;
+        case MAX_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                __m256d current = _mm256_loadu_pd(&values[i]);
+                result = _mm256_blendv_pd(result, current, _mm256_cmp_pd(result, current, _CMP_LT_OQ));
+            }
+            break;
+        case MIN_FOLD_OPERATOR:
+            for (; i + 4 <= count; i += 4) {
+                __m256d current = _mm256_loadu_pd(&values[i]);
+                result = _mm256_blendv_pd(result, current, _mm256_cmp_pd(result, current, _CMP_GT_OQ));
+            }
+            break;
+        case AND_FOLD_OPERATOR:
+        case OR_FOLD_OPERATOR:
+        case XOR_FOLD_OPERATOR:
+        case NO_FOLD_OPERATOR:
+        default:
+            return reduce_doubles(fold_operator, values, count);
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, result);
+
+    double reduced = reduce_doubles(fold_operator, lanes, 4);
+    for (; i < count; ++i) reduced = combine_doubles(fold_operator, reduced, values[i]);
+
+    return reduced;
+}
+
+#endif
+
+long reduce_longs(FoldOperator fold_operator, const long *values, size_t count) {
+#ifdef X86_REDUCTIONS
+    if (__builtin_cpu_supports("avx2")) return reduce_longs_avx2(fold_operator, values, count);
+
+    return reduce_longs_sse2(fold_operator, values, count);
+#else
+    return reduce_longs_scalar(fold_operator, values, count);
+#endif
+}
+
+double reduce_doubles_unordered(FoldOperator fold_operator, const double *values, size_t count) {
+#ifdef X86_REDUCTIONS
+    if (__builtin_cpu_supports("avx2")) return reduce_doubles_avx2(fold_operator, values, count);
+
+    return reduce_doubles_sse2(fold_operator, values, count);
+#else
+    return reduce_doubles(fold_operator, values, count);
+#endif
+}
@@ -0,0 +1,61 @@
+/**
+ * @file reductions.h
+ * @brief Reduções de arrays de longs e doubles com um operador associativo (usadas pelo fold), com kernels SIMD
+ * (AVX2 ou SSE2) escolhidos em tempo de execução e uma versão escalar para os outros processadores.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Operadores associativos que o fold sabe reduzir sem executar o bloco
+ */
+typedef enum {
+    /** @brief O bloco não é um único operador associativo */
+    NO_FOLD_OPERATOR,
+    /** @brief + */
+    ADD_FOLD_OPERATOR,
+    /** @brief * */
+    MULTIPLY_FOLD_OPERATOR,
+    /** @brief e> */
+    MAX_FOLD_OPERATOR,
+    /** @brief e< */
+    MIN_FOLD_OPERATOR,
+    /** @brief & */
+    AND_FOLD_OPERATOR,
+    /** @brief | */
+    OR_FOLD_OPERATOR,
+    /** @brief ^ */
+    XOR_FOLD_OPERATOR
+} FoldOperator;
+
+/**
+ * Reduz longs com um operador. As somas e produtos dão a volta como as operações + e * dos longs, por isso o
+ * resultado é igual ao da redução da esquerda para a direita.
+ * @param fold_operator operador
+ * @param values os longs
+ * @param count número de longs (pelo menos um)
+ * @return O resultado
+ */
+long reduce_longs(FoldOperator fold_operator, const long *values, size_t count);
+
+/**
+ * Reduz doubles com um operador (sem os operadores bitwise) da esquerda para a direita, com as mesmas comparações
+ * que e> e e< (o resultado é igual ao do bloco, mesmo com NaN)
+ * @param fold_operator operador
+ * @param values os doubles
+ * @param count número de doubles (pelo menos um)
+ * @return O resultado
+ */
+double reduce_doubles(FoldOperator fold_operator, const double *values, size_t count);
+
+/**
+ * Reduz doubles com um operador (sem os operadores bitwise) com kernels SIMD. As operações são reagrupadas, por
+ * isso os arredondamentos (e, com e> e e<, os NaN e o sinal dos zeros) podem ser diferentes dos de reduce_doubles.
+ * @param fold_operator operador
+ * @param values os doubles
+ * @param count número de doubles (pelo menos um)
+ * @return O resultado
+ */
+double reduce_doubles_unordered(FoldOperator fold_operator, const double *values, size_t count);
@@ -0,0 +1,500 @@
+/**
+ * @file sorting.c
+ * @brief Implementação dos algoritmos de ordenação sem comparações
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sorting.h"
+#include "thread_pool.h"
+
+#ifndef PARALLEL_SORT_THRESHOLD
+/** Número mínimo de elementos para as ordenações serem feitas em paralelo (configurável no CMake) */
+#define PARALLEL_SORT_THRESHOLD 65536
+#endif
+
+/** Número de partes de uma ordenação paralela por thread */
+#define PARALLEL_SORT_PARTS_PER_THREAD 4
+
+/** Número de bits ordenados em cada passagem do radix sort */
+#define RADIX_BITS 8
+/** Número de baldes de cada passagem do radix sort */
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+/** Número de passagens para ordenar chaves de 64 bits */
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+/** Bit de sinal de uma chave de 64 bits */
+#define SIGN_BIT ((uint64_t) 1 << 63)
+
+/** Abaixo deste tamanho o multikey quicksort usa insertion sort */
+#define MULTIKEY_INSERTION_THRESHOLD 16
+
+/**
+ * @brief Ordena chaves sem sinal de 64 bits (LSD), saltando as passagens em que todas as chaves caem no mesmo balde
+ * @param keys as chaves
+ * @param length número de chaves
+ */
+static void radix_sort_keys(uint64_t *keys, size_t length) {
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS] = {{0}};
+
+    for (size_t i = 0; i < length; i++) {
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][(keys[i] >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    uint64_t *buffer = malloc(length * sizeof(uint64_t));
+    uint64_t *from = keys, *to = buffer;
+
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        size_t *pass_counts = counts[pass];
+        if (pass_counts[(from[0] >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)] == length) continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            size_t count = pass_counts[bucket];
+            pass_counts[bucket] = offset;
+            offset += count;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            to[pass_counts[(from[i] >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+
+        uint64_t *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != keys) memcpy(keys, from, length * sizeof(uint64_t));
+    free(buffer);
+}
+
+/**
+ * Argumentos de uma passagem do radix sort paralelo
+ */
+typedef struct {
+    /** Chaves a distribuir */
+    uint64_t *from;
+    /** Destino das chaves */
+    uint64_t *to;
+    /** Número de chaves de cada parte */
+    int grain;
+    /** Deslocamento dos bits da passagem */
+    int shift;
+    /** Contagem (e depois posição de destino) de cada balde, por parte */
+    size_t (*counts)[RADIX_BUCKETS];
+} RadixPassJob;
+
+/**
+ * @brief Conta as chaves de uma parte em cada balde da passagem
+ * @param context o RadixPassJob
+ * @param start primeira chave
+ * @param end chave a seguir à última
+ */
+static void count_radix_part(void *context, int start, int end) {
+    RadixPassJob *job = context;
+    size_t *counts = job->counts[start / job->grain];
+
+    memset(counts, 0, RADIX_BUCKETS * sizeof(size_t));
+    for (int i = start; i < end; i++) {
+        counts[(job->from[i] >> job->shift) & (RADIX_BUCKETS - 1)]++;
+    }
+}
+
+/**
+ * @brief Distribui as chaves de uma parte pelas posições de destino calculadas
+ * @param context o RadixPassJob
+ * @param start primeira chave
+ * @param end chave a seguir à última
+ */
+static void scatter_radix_part(void *context, int start, int end) {
+    RadixPassJob *job = context;
+    size_t *positions = job->counts[start / job->grain];
+
+    for (int i = start; i < end; i++) {
+        job->to[positions[(job->from[i] >> job->shift) & (RADIX_BUCKETS - 1)]++] = job->from[i];
+    }
+}
+
+/**
+ * @brief Radix sort LSD paralelo: em cada passagem as partes contam os baldes e distribuem as chaves em paralelo
+ * (as posições de cada parte dentro de cada balde seguem a ordem das partes, por isso cada passagem é estável)
+ * @param keys as chaves
+ * @param length número de chaves
+ */
+static void parallel_radix_sort_keys(uint64_t *keys, size_t length) {
+    int part_count = get_thread_pool_size() * PARALLEL_SORT_PARTS_PER_THREAD;
+    int grain = (int) ((length + (size_t) part_count - 1) / (size_t) part_count);
+    part_count = (int) ((length + (size_t) grain - 1) / (size_t) grain);
+
+    uint64_t *buffer = malloc(length * sizeof(uint64_t));
+    RadixPassJob job = {keys, buffer, grain, 0, malloc((size_t) part_count * sizeof(size_t[RADIX_BUCKETS]))};
+
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        job.shift = pass * RADIX_BITS;
+        parallel_for((int) length, grain, count_radix_part, &job);
+
+        size_t offset = 0;
+        int single_bucket = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            size_t bucket_start = offset;
+            for (int part = 0; part < part_count; part++) {
+                size_t count = job.counts[part][bucket];
+                job.counts[part][bucket] = offset;
+                offset += count;
+            }
+            if (offset - bucket_start == length) single_bucket = 1;
+        }
+        if (single_bucket) continue;
+
+        parallel_for((int) length, grain, scatter_radix_part, &job);
+
+        uint64_t *swap = job.from;
+        job.from = job.to;
+        job.to = swap;
+    }
+
+    if (job.from != keys) memcpy(keys, job.from, length * sizeof(uint64_t));
+    free(job.counts);
+    free(buffer);
+}
+
+int is_parallel_sort(size_t length) {
+    return length >= PARALLEL_SORT_THRESHOLD && get_thread_pool_size() > 1;
+}
+
+/**
+ * @brief Ordena chaves sem sinal de 64 bits, em paralelo se forem muitas
+ * @param keys as chaves
+ * @param length número de chaves
+ */
+static void sort_keys(uint64_t *keys, size_t length) {
+    if (is_parallel_sort(length)) {
+        parallel_radix_sort_keys(keys, length);
+    } else {
+        radix_sort_keys(keys, length);
+    }
+}
+
+void radix_sort_longs(long *values, size_t length) {
+    if (length < 2) return;
+
+    uint64_t *keys = malloc(length * sizeof(uint64_t));
+    for (size_t i = 0; i < length; i++) {
+        keys[i] = (uint64_t) values[i] ^ SIGN_BIT;
+    }
+
+    sort_keys(keys, length);
+
+    for (size_t i = 0; i < length; i++) {
+        values[i] = (long) (keys[i] ^ SIGN_BIT);
+    }
+    free(keys);
+}
+
+void radix_sort_doubles(double *values, size_t length) {
+    if (length < 2) return;
+
+    uint64_t *keys = malloc(length * sizeof(uint64_t));
+    for (size_t i = 0; i < length; i++) {
+        uint64_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        // Os negativos ficam com os bits todos invertidos, os positivos só com o sinal invertido
+        keys[i] = bits & SIGN_BIT ? ~bits : bits ^ SIGN_BIT;
+    }
+
+    sort_keys(keys, length);
+
+    for (size_t i = 0; i < length; i++) {
+        uint64_t bits = keys[i] & SIGN_BIT ? keys[i] ^ SIGN_BIT : ~keys[i];
+        memcpy(&values[i], &bits, sizeof(bits));
+    }
+    free(keys);
+}
+
+void counting_sort_chars(char *values, size_t length) {
+    size_t counts[UINT8_MAX + 1] = {0};
+
+    for (size_t i = 0; i < length; i++) {
+        counts[(unsigned char) values[i]]++;
+    }
+
+    size_t position = 0;
+    for (int value = CHAR_MIN; value <= CHAR_MAX; value++) {
+        size_t count = counts[(unsigned char) value];
+        memset(values + position, value, count);
+        position += count;
+    }
+}
+
+/**
+ * @brief Caractere de uma string numa posição, -1 depois do fim (a string mais curta fica primeiro)
+ * @param string a string
+ * @param depth a posição
+ * @return O caractere
+ */
+static int char_at(const SortString *string, size_t depth) {
+    return depth < string->length ? string->chars[depth] : -1;
+}
+
+/**
+ * @brief Troca duas strings
+ * @param a string
+ * @param b string
+ */
+static void swap_strings(SortString *a, SortString *b) {
+    SortString swap = *a;
+    *a = *b;
+    *b = swap;
+}
+
+/**
+ * @brief Compara duas strings a partir de uma posição (os caracteres antes dela são iguais)
+ * @param a string
+ * @param b string
+ * @param depth a posição
+ * @return Negativo, zero ou positivo
+ */
+static int compare_strings_from(const SortString *a, const SortString *b, size_t depth) {
+    size_t a_length = a->length - depth, b_length = b->length - depth;
+    int result = memcmp(a->chars + depth, b->chars + depth, a_length < b_length ? a_length : b_length);
+    if (result != 0) return result;
+
+    return (a_length > b_length) - (a_length < b_length);
+}
+
+/**
+ * @brief Ordena poucas strings por inserção, comparando a partir de uma posição
+ * @param strings as strings
+ * @param length número de strings
+ * @param depth a posição a partir da qual as strings podem diferir
+ */
+static void insertion_sort_strings(SortString *strings, size_t length, size_t depth) {
+    for (size_t i = 1; i < length; i++) {
+        SortString key = strings[i];
+        size_t j = i;
+
+        while (j > 0 && compare_strings_from(&strings[j - 1], &key, depth) > 0) {
+            strings[j] = strings[j - 1];
+            j--;
+        }
+        strings[j] = key;
+    }
+}
+
+/**
+ * @brief Multikey quicksort das strings cujos primeiros depth caracteres são iguais
+ * @param strings as strings
+ * @param length número de strings
+ * @param depth a posição do caractere a usar como chave
+ */
+static void multikey_quicksort_from(SortString *strings, size_t length, size_t depth) {
+    while (length > MULTIKEY_INSERTION_THRESHOLD) {
+        swap_strings(&strings[0], &strings[length / 2]);
+        int pivot = char_at(&strings[0], depth);
+
+        // strings[0..less[ < pivot, strings[less..i[ == pivot, strings[greater..length[ > pivot
+        size_t less = 0, i = 1, greater = length;
+        while (i < greater) {
+            int c = char_at(&strings[i], depth);
+            if (c < pivot) {
+                swap_strings(&strings[less++], &strings[i++]);
+            } else if (c > pivot) {
+                swap_strings(&strings[i], &strings[--greater]);
+            } else {
+                i++;
+            }
+        }
+
+        multikey_quicksort_from(strings, less, depth);
+        multikey_quicksort_from(strings + greater, length - greater, depth);
+
+        // As strings que acabaram (pivot -1) já estão ordenadas entre si
+        if (pivot < 0) return;
+
+        strings += less;
+        length = greater - less;
+        depth++;
+    }
+
+    insertion_sort_strings(strings, length, depth);
+}
+
+void multikey_quicksort(SortString *strings, size_t length) {
+    multikey_quicksort_from(strings, length, 0);
+}
+
+/**
+ * @brief Merge sort estável (top-down) das posições order[start..end[
+ * @param order posições a ordenar
+ * @param buffer memória auxiliar com o mesmo tamanho de order
+ * @param start primeira posição
+ * @param end posição a seguir à última
+ * @param compare comparação das posições
+ * @param context argumento da comparação
+ */
+static void merge_sort_range(int *order, int *buffer, int start, int end, OrderCompare compare, void *context) {
+    if (end - start < 2) return;
+
+    int middle = start + (end - start) / 2;
+    merge_sort_range(order, buffer, start, middle, compare, context);
+    merge_sort_range(order, buffer, middle, end, compare, context);
+
+    if (compare(context, order[middle - 1], order[middle]) <= 0) return;
+
+    int left = start, right = middle, to = start;
+    while (left < middle && right < end) {
+        if (compare(context, order[left], order[right]) > 0) {
+            buffer[to++] = order[right++];
+        } else {
+            buffer[to++] = order[left++];
+        }
+    }
+    while (left < middle) buffer[to++] = order[left++];
+    while (right < end) buffer[to++] = order[right++];
+
+    memcpy(order + start, buffer + start, (size_t) (end - start) * sizeof(int));
+}
+
+/**
+ * Argumentos do merge sort paralelo
+ */
+typedef struct {
+    /** Comparação das posições */
+    OrderCompare compare;
+    /** Argumento da comparação */
+    void *context;
+    /** Número de posições */
+    int length;
+    /** Posições a ordenar */
+    int *order;
+    /** Memória auxiliar */
+    int *buffer;
+    /** Sequências ordenadas a juntar */
+    int *from;
+    /** Destino das sequências juntas */
+    int *to;
+    /** Tamanho das sequências ordenadas */
+    int width;
+} MergeSortJob;
+
+/**
+ * @brief Ordena uma parte das posições
+ * @param context o MergeSortJob
+ * @param start primeira posição
+ * @param end posição a seguir à última
+ */
+static void sort_order_part(void *context, int start, int end) {
+    MergeSortJob *job = context;
+
+    merge_sort_range(job->order, job->buffer, start, end, job->compare, job->context);
+}
+
+/**
+ * @brief Calcula quantos dos primeiros @param{k} elementos de um merge estável vêm da sequência da esquerda
+ * (procura binária no merge path)
+ * @param job o MergeSortJob
+ * @param left sequência da esquerda
+ * @param left_length tamanho da sequência da esquerda
+ * @param right sequência da direita
+ * @param right_length tamanho da sequência da direita
+ * @param k número de elementos do resultado
+ * @return O número de elementos da esquerda
+ */
+static int split_merge(MergeSortJob *job, const int *left, int left_length, const int *right, int right_length,
+                       int k) {
+    int low = k > right_length ? k - right_length : 0;
+    int high = k < left_length ? k : left_length;
+
+    for (;;) {
+        int i = low + (high - low) / 2;
+        int j = k - i;
+
+        if (i > 0 && j < right_length && job->compare(job->context, left[i - 1], right[j]) > 0) {
+            high = i - 1;
+        } else if (j > 0 && i < left_length && job->compare(job->context, left[i], right[j - 1]) <= 0) {
+            low = i + 1;
+        } else {
+            return i;
+        }
+    }
+}
+
+/**
+ * @brief Junta os elementos [start, end[ do resultado de juntar as sequências de tamanho width
+ * @param context o MergeSortJob
+ * @param start primeira posição do resultado
+ * @param end posição a seguir à última
+ */
+static void merge_order_part(void *context, int start, int end) {
+    MergeSortJob *job = context;
+    int pair_width = 2 * job->width;
+
+    for (int pair_start = start - start % pair_width; pair_start < end; pair_start += pair_width) {
+        int middle = job->length - pair_start < job->width ? job->length : pair_start + job->width;
+        int pair_end = job->length - pair_start < pair_width ? job->length : pair_start + pair_width;
+
+        const int *left = job->from + pair_start, *right = job->from + middle;
+        int left_length = middle - pair_start, right_length = pair_end - middle;
+
+        int first = (start > pair_start ? start : pair_start) - pair_start;
+        int last = (end < pair_end ? end : pair_end) - pair_start;
+
+        int i = split_merge(job, left, left_length, right, right_length, first);
+        int j = first - i;
+        int left_end = split_merge(job, left, left_length, right, right_length, last);
+        int right_end = last - left_end;
+
+        int *to = job->to + pair_start + first;
+        while (i < left_end && j < right_end) {
+            if (job->compare(job->context, left[i], right[j]) > 0) {
+                *to++ = right[j++];
+            } else {
+                *to++ = left[i++];
+            }
+        }
+        while (i < left_end) *to++ = left[i++];
+        while (j < right_end) *to++ = right[j++];
+    }
+}
+
+/**
+ * @brief Merge sort paralelo: as partes são ordenadas em paralelo e depois juntadas duas a duas; cada junção é
+ * dividida em partes independentes pelo merge path, por isso todos os níveis são paralelos
+ * @param job o MergeSortJob
+ */
+static void parallel_merge_sort_order(MergeSortJob *job) {
+    int part_count = get_thread_pool_size() * PARALLEL_SORT_PARTS_PER_THREAD;
+    int grain = (job->length + part_count - 1) / part_count;
+
+    parallel_for(job->length, grain, sort_order_part, job);
+
+    job->from = job->order;
+    job->to = job->buffer;
+    for (job->width = grain; job->width < job->length; job->width *= 2) {
+        parallel_for(job->length, grain, merge_order_part, job);
+
+        int *swap = job->from;
+        job->from = job->to;
+        job->to = swap;
+    }
+
+    if (job->from != job->order) memcpy(job->order, job->from, (size_t) job->length * sizeof(int));
+}
+
+void merge_sort_order(int *order, int length, OrderCompare compare, void *context) {
+    if (length < 2) return;
+
+    MergeSortJob job = {compare, context, length, order, malloc((size_t) length * sizeof(int)), NULL, NULL, 0};
+
+    if (is_parallel_sort((size_t) length)) {
+        parallel_merge_sort_order(&job);
+    } else {
+        merge_sort_range(order, job.buffer, 0, length, compare, context);
+    }
+
+    free(job.buffer);
+}
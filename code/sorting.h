@@ -0,0 +1,72 @@
+/**
+ * @file sorting.h
+ * @brief Algoritmos de ordenação usados para ordenar arrays: radix sorts sem comparações para ordenar pelo valor e
+ * um merge sort estável por comparações. Acima de PARALLEL_SORT_THRESHOLD elementos são executados em paralelo.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Uma string a ordenar com multikey_quicksort
+ */
+typedef struct {
+    /** Caracteres da string (pode conter '\0') */
+    const unsigned char *chars;
+    /** Tamanho da string */
+    size_t length;
+    /** Posição original da string */
+    int index;
+} SortString;
+
+/**
+ * Comparação de duas posições para merge_sort_order
+ * @return Positivo se a posição @param{a} deve ficar depois da posição @param{b}
+ */
+typedef int (*OrderCompare)(void *context, int a, int b);
+
+/**
+ * Verifica se uma ordenação de @param{length} elementos é feita em paralelo
+ * @param length número de elementos
+ * @return 1 se tem pelo menos PARALLEL_SORT_THRESHOLD elementos e a pool tem mais de uma thread
+ */
+int is_parallel_sort(size_t length);
+
+/**
+ * Ordena longs com um radix sort LSD (8 bits por passagem)
+ * @param values os longs
+ * @param length número de longs
+ */
+void radix_sort_longs(long *values, size_t length);
+
+/**
+ * Ordena doubles com um radix sort LSD sobre a representação binária (os NaN ficam nas pontas conforme o sinal)
+ * @param values os doubles
+ * @param length número de doubles
+ */
+void radix_sort_doubles(double *values, size_t length);
+
+/**
+ * Ordena caracteres (com sinal, como em compare_elements) por contagem
+ * @param values os caracteres
+ * @param length número de caracteres
+ */
+void counting_sort_chars(char *values, size_t length);
+
+/**
+ * Ordena strings com um multikey quicksort (quicksort de três vias sobre cada caractere).
+ * A ordem é a de compare_string_elements: bytes sem sinal e, em caso de prefixo, a mais curta primeiro.
+ * @param strings as strings
+ * @param length número de strings
+ */
+void multikey_quicksort(SortString *strings, size_t length);
+
+/**
+ * Ordena posições com um merge sort estável (as posições iguais mantêm a ordem)
+ * @param order as posições
+ * @param length número de posições
+ * @param compare comparação das posições
+ * @param context argumento da comparação
+ */
+void merge_sort_order(int *order, int length, OrderCompare compare, void *context);
@@ -10,24 +10,698 @@
 #include "logger.h"
 #include "conversions.h"
 #include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
 
-Stack *create_stack(int initial_capacity) {
-    Stack *stack = malloc(sizeof(Stack));
+/**
+ * Cabeçalho guardado imediatamente antes dos caracteres de uma string ou bloco.
+ * Os caracteres são sempre terminados em '\0', mas podem conter '\0' antes de @param{length}.
+ */
+typedef struct {
+    /** Número de elementos que partilham a string */
+    int reference_count;
+    /** Número de caracteres da string */
+    size_t length;
+    /** Número de caracteres que cabem na memória alocada (sem contar com o '\0') */
+    size_t capacity;
+} SharedStringHeader;
+
+/**
+ * Contador de referências das strings partilhadas imortais, que nunca é alterado
+ */
+#define IMMORTAL_REFERENCE_COUNT INT_MAX
+
+/**
+ * Aloca uma string partilhada com @param{length} caracteres por preencher
+ * @param length número de caracteres
+ * @param capacity número de caracteres que a memória alocada deve suportar
+ * @return Os caracteres da string alocada (terminados em '\0')
+ */
+static char *allocate_shared_string_with_capacity(size_t length, size_t capacity) {
+    SharedStringHeader *header = malloc(sizeof(SharedStringHeader) + capacity + 1);
+    header->reference_count = 1;
+    header->length = length;
+    header->capacity = capacity;
+
+    char *string = (char *) (header + 1);
+    string[length] = '\0';
+
+    return string;
+}
+
+/**
+ * Aloca uma string partilhada com @param{length} caracteres por preencher
+ * @param length número de caracteres
+ * @return Os caracteres da string alocada (terminados em '\0')
+ */
+static char *allocate_shared_string(size_t length) {
+    return allocate_shared_string_with_capacity(length, length);
+}
+
+/**
+ * Aloca uma string partilhada com os primeiros @param{length} caracteres de @param{value}
+ * @param value caracteres a copiar
+ * @param length número de caracteres
+ * @return Os caracteres da string alocada (terminados em '\0')
+ */
+static char *create_shared_string(const char *value, size_t length) {
+    char *string = allocate_shared_string(length);
+    memcpy(string, value, length);
+
+    return string;
+}
+
+/**
+ * Retorna o cabeçalho de uma string partilhada
+ * @param string os caracteres da string
+ * @return O cabeçalho
+ */
+static SharedStringHeader *get_shared_string_header(char *string) {
+    return ((SharedStringHeader *) string) - 1;
+}
 
-    stack->capacity = initial_capacity;
+/**
+ * Verifica se um elemento string está guardado dentro do próprio elemento
+ * @param element elemento string
+ * @return 1 se é uma string curta, 0 caso contrário
+ */
+static int is_short_string(StackElement *element) {
+    return element->short_string.length != LONG_STRING_MARKER;
+}
+
+/**
+ * Liberta uma referência para a string partilhada, a memória é libertada quando não restam referências
+ * @param string os caracteres da string
+ */
+static void release_shared_string(char *string) {
+    SharedStringHeader *header = get_shared_string_header(string);
+
+    if (header->reference_count == IMMORTAL_REFERENCE_COUNT) return;
+
+    if (--header->reference_count == 0) {
+        free(header);
+    }
+}
+
+/**
+ * Adiciona uma referência à string partilhada
+ * @param string os caracteres da string
+ */
+static void retain_shared_string(char *string) {
+    SharedStringHeader *header = get_shared_string_header(string);
+
+    if (header->reference_count != IMMORTAL_REFERENCE_COUNT) header->reference_count++;
+}
+
+/**
+ * Número de classes de tamanho da pool: as arrays têm 2^STACK_POOL_MIN_SIZE_CLASS até
+ * 2^(STACK_POOL_MIN_SIZE_CLASS + STACK_POOL_SIZE_CLASSES - 1) bytes
+ */
+#define STACK_POOL_SIZE_CLASSES 12
+
+/**
+ * Expoente da classe de tamanho mais pequena da pool (8 bytes, um valor NaN-boxed)
+ */
+#define STACK_POOL_MIN_SIZE_CLASS 3
+
+/**
+ * Número máximo de blocos guardados em cada lista livre da pool
+ */
+#define STACK_POOL_MAX_FREE 64
+
+/**
+ * Lista livre de blocos de memória reutilizáveis, o pointer para o próximo bloco é guardado no próprio bloco
+ */
+typedef struct {
+    /** Primeiro bloco livre */
+    void *head;
+    /** Número de blocos na lista */
+    int count;
+} StackPoolFreeList;
+
+/** Cabeçalhos (struct Stack) livres (cada thread tem a sua pool) */
+static _Thread_local StackPoolFreeList free_stack_headers;
+
+/** Arrays de elementos livres, por classe de tamanho */
+static _Thread_local StackPoolFreeList free_stack_buffers[STACK_POOL_SIZE_CLASSES];
+
+/** Contadores da pool */
+static _Thread_local StackPoolStats stack_pool_stats;
+
+/**
+ * Retira um bloco de uma lista livre ou aloca-o com malloc se a lista estiver vazia
+ * @param list lista livre
+ * @param size tamanho do bloco
+ * @param hits contador a incrementar quando o bloco vem da lista
+ * @return O bloco
+ */
+static void *pool_allocate(StackPoolFreeList *list, size_t size, unsigned long *hits) {
+    void *block = list->head;
+
+    if (block == NULL) return malloc(size);
+
+    list->head = *(void **) block;
+    list->count--;
+    (*hits)++;
+
+    return block;
+}
+
+/**
+ * Devolve um bloco a uma lista livre, ou liberta-o se a lista já estiver cheia
+ * @param list lista livre
+ * @param block o bloco
+ */
+static void pool_release(StackPoolFreeList *list, void *block) {
+    if (list->count >= STACK_POOL_MAX_FREE) {
+        free(block);
+        return;
+    }
+
+    *(void **) block = list->head;
+    list->head = block;
+    list->count++;
+}
+
+/**
+ * Retorna a classe de tamanho de uma array (o índice da menor potência de 2 que não é menor que @param{size})
+ * @param size número de bytes
+ * @return O índice da classe na pool (pode ser maior que o número de classes)
+ */
+static int get_size_class(size_t size) {
+    int size_class = 0;
+    while (((size_t) 1 << (size_class + STACK_POOL_MIN_SIZE_CLASS)) < size) size_class++;
+
+    return size_class;
+}
+
+/**
+ * Retorna o tamanho de cada posição da array de uma stack
+ * @param storage o armazenamento da stack
+ * @return O número de bytes
+ */
+static size_t get_storage_element_size(StackStorage storage) {
+    switch (storage) {
+        case NAN_BOXED_STORAGE:
+            return sizeof(Value);
+        case LONG_STORAGE:
+            return sizeof(long);
+        case DOUBLE_STORAGE:
+            return sizeof(double);
+        case CHAR_STORAGE:
+            return sizeof(char);
+        case BOXED_STORAGE:
+        default:
+            return sizeof(StackElement);
+    }
+}
+
+/**
+ * Retorna o tamanho da array de uma stack
+ * @param storage o armazenamento da stack
+ * @param capacity a capacidade da stack
+ * @return O número de bytes
+ */
+static size_t get_buffer_size(StackStorage storage, int capacity) {
+    return (unsigned long) capacity * get_storage_element_size(storage);
+}
+
+/**
+ * Aloca a array de uma stack, na arena da stack ou reaproveitando uma array da pool.
+ * Só a primeira array de uma stack da arena é alocada na arena: a stack pode crescer enquanto executa um bloco
+ * aninhado (ex: ~ dentro de um map), e uma array alocada depois da marca dessa invocação seria libertada quando ela
+ * voltasse à marca.
+ * @param stack a stack (a sua arena)
+ * @param size número de bytes
+ * @return A array
+ */
+static void *allocate_stack_buffer(Stack *stack, size_t size) {
+    if (stack->arena != NULL && stack->buffer == NULL) {
+        stack->is_buffer_in_arena = 1;
+        return arena_allocate(stack->arena, size);
+    }
+
+    int size_class = get_size_class(size);
+
+    stack_pool_stats.buffer_requests++;
+
+    if (size_class >= STACK_POOL_SIZE_CLASSES) return malloc(size);
+
+    return pool_allocate(&free_stack_buffers[size_class], (size_t) 1 << (size_class + STACK_POOL_MIN_SIZE_CLASS),
+                         &stack_pool_stats.buffer_hits);
+}
+
+/**
+ * Devolve a array atual de uma stack à pool (as arrays das arenas só são libertadas com a arena)
+ * @param stack a stack
+ * @param buffer a array
+ * @param size número de bytes com que a array foi alocada
+ */
+static void release_stack_buffer(Stack *stack, void *buffer, size_t size) {
+    if (buffer == NULL) return;
+
+    if (stack->is_buffer_in_arena) {
+        stack->is_buffer_in_arena = 0;
+        return;
+    }
+
+    int size_class = get_size_class(size);
+
+    if (size_class >= STACK_POOL_SIZE_CLASSES) {
+        free(buffer);
+        return;
+    }
+
+    pool_release(&free_stack_buffers[size_class], buffer);
+}
+
+/**
+ * Armazenamento que suporta qualquer elemento (ou quase, no caso de NAN_BOXED_STORAGE)
+ */
+#ifdef NAN_BOXING
+#define GENERAL_STACK_STORAGE NAN_BOXED_STORAGE
+#else
+#define GENERAL_STACK_STORAGE BOXED_STORAGE
+#endif
+
+/**
+ * Inicializa os campos de uma stack vazia.
+ * A array só é alocada no primeiro push, quando já se sabe o tipo do primeiro elemento.
+ * @param stack target
+ * @param initial_capacity capacidade incial
+ * @param arena arena da stack, ou NULL
+ * @return A stack
+ */
+static Stack *initialize_stack(Stack *stack, int initial_capacity, Arena *arena) {
+    int capacity = 1;
+    while (capacity < initial_capacity) capacity <<= 1;
+
+    stack->reference_count = 1;
+    stack->capacity = capacity;
     stack->current_index = -1;
-    stack->array = calloc((unsigned long) initial_capacity, sizeof(StackElement));
+    stack->storage = GENERAL_STACK_STORAGE;
+    stack->arena = arena;
+    stack->is_buffer_in_arena = 0;
+    stack->buffer = NULL;
 
     return stack;
 }
 
+Stack *create_stack(int initial_capacity) {
+    stack_pool_stats.header_requests++;
+    Stack *stack = pool_allocate(&free_stack_headers, sizeof(Stack), &stack_pool_stats.header_hits);
+
+    return initialize_stack(stack, initial_capacity, NULL);
+}
+
+Stack *create_stack_in_arena(Arena *arena, int initial_capacity) {
+    return initialize_stack(arena_allocate(arena, sizeof(Stack)), initial_capacity, arena);
+}
+
+/**
+ * Valores NaN-boxed: um double é guardado tal como é, os outros tipos são guardados no payload (48 bits) de um NaN
+ * negativo com os 16 bits de cima iguais a uma das tags seguintes. Os NaN verdadeiros são normalizados para
+ * VALUE_CANONICAL_NAN (com o sinal original), que não colide com as tags.
+ */
+#define VALUE_TAG_SHIFT 48
+/** Máscara do payload de um valor */
+#define VALUE_PAYLOAD_MASK (((Value) 1 << VALUE_TAG_SHIFT) - 1)
+/** Bit de sinal dos longs guardados no payload */
+#define VALUE_LONG_SIGN_BIT ((long) 1 << (VALUE_TAG_SHIFT - 1))
+/** Bit de sinal de um double */
+#define VALUE_SIGN_BIT ((Value) 1 << 63)
+/** NaN usado para todos os doubles NaN (mantendo o sinal) */
+#define VALUE_CANONICAL_NAN ((Value) 0x7FF8000000000000)
+/** Menor tag, os valores abaixo dela são doubles */
+#define VALUE_MIN_TAG ((Value) 0xFFF9)
+/** Tag dos longs que cabem em 48 bits (com sinal) */
+#define VALUE_LONG_TAG ((Value) 0xFFF9)
+/** Tag dos chars */
+#define VALUE_CHAR_TAG ((Value) 0xFFFA)
+/** Tag das strings guardadas fora do elemento (pointer para os caracteres) */
+#define VALUE_STRING_TAG ((Value) 0xFFFB)
+/** Tag das arrays (pointer para a stack) */
+#define VALUE_ARRAY_TAG ((Value) 0xFFFC)
+/** Tag dos blocos (pointer para os caracteres) */
+#define VALUE_BLOCK_TAG ((Value) 0xFFFD)
+/** Tag dos longs que não cabem em 48 bits (pointer para o long) */
+#define VALUE_BOXED_LONG_TAG ((Value) 0xFFFE)
+
+/**
+ * @param tag tag do valor
+ * @param payload os 48 bits do valor
+ * @return O valor
+ */
+static Value make_value(Value tag, Value payload) {
+    return (tag << VALUE_TAG_SHIFT) | (payload & VALUE_PAYLOAD_MASK);
+}
+
+/**
+ * Guarda um pointer num valor
+ * @param tag tag do valor
+ * @param pointer o pointer
+ * @param to onde guardar o valor
+ * @return 1 se o pointer cabe em 48 bits, 0 caso contrário
+ */
+static int encode_pointer_value(Value tag, void *pointer, Value *to) {
+    uintptr_t address = (uintptr_t) pointer;
+    if ((address >> VALUE_TAG_SHIFT) != 0) return 0;
+
+    *to = make_value(tag, (Value) address);
+    return 1;
+}
+
+/**
+ * @param value o valor
+ * @return O pointer guardado no valor
+ */
+static void *get_value_pointer(Value value) {
+    return (void *) (uintptr_t) (value & VALUE_PAYLOAD_MASK);
+}
+
+/**
+ * @param value o valor
+ * @return 1 se o valor é um long guardado no payload
+ */
+static int is_long_value(Value value) {
+    return (value >> VALUE_TAG_SHIFT) == VALUE_LONG_TAG;
+}
+
+/**
+ * @param value o valor
+ * @return 1 se o valor é um double
+ */
+static int is_double_value(Value value) {
+    return (value >> VALUE_TAG_SHIFT) < VALUE_MIN_TAG;
+}
+
+/**
+ * @param value valor com a tag VALUE_LONG_TAG
+ * @return O long guardado no payload
+ */
+static long get_long_value(Value value) {
+    return ((long) (value & VALUE_PAYLOAD_MASK) ^ VALUE_LONG_SIGN_BIT) - VALUE_LONG_SIGN_BIT;
+}
+
+/**
+ * @param value long
+ * @return 1 se o long cabe no payload
+ */
+static int long_fits_in_value(long value) {
+    return value >= -VALUE_LONG_SIGN_BIT && value < VALUE_LONG_SIGN_BIT;
+}
+
+/**
+ * @param value o valor (double)
+ * @return O double
+ */
+static double get_double_value(Value value) {
+    double result;
+    memcpy(&result, &value, sizeof(Value));
+    return result;
+}
+
+/**
+ * @param value double
+ * @return O valor NaN-boxed do double
+ */
+static Value create_double_value(double value) {
+    Value bits;
+    memcpy(&bits, &value, sizeof(Value));
+    return isnan(value) ? (bits & VALUE_SIGN_BIT) | VALUE_CANONICAL_NAN : bits;
+}
+
+/**
+ * Converte um elemento para a sua forma NaN-boxed, passando a posse do seu conteudo para o valor
+ * @param element o elemento
+ * @param to onde guardar o valor
+ * @return 1 se o elemento foi convertido, 0 se não tem forma NaN-boxed (strings curtas ou pointers fora de 48 bits)
+ */
+static int encode_value(StackElement *element, Value *to) {
+    long long_value;
+
+    switch (element->type) {
+        case DOUBLE_TYPE:
+            *to = create_double_value(element->content.double_value);
+            return 1;
+        case LONG_TYPE:
+            long_value = element->content.long_value;
+            if (long_fits_in_value(long_value)) {
+                *to = make_value(VALUE_LONG_TAG, (Value) long_value);
+                return 1;
+            } else {
+                long *box = malloc(sizeof(long));
+                *box = long_value;
+                if (encode_pointer_value(VALUE_BOXED_LONG_TAG, box, to)) return 1;
+                free(box);
+                return 0;
+            }
+        case CHAR_TYPE:
+            *to = make_value(VALUE_CHAR_TAG, (unsigned char) element->content.char_value);
+            return 1;
+        case STRING_TYPE:
+            if (is_short_string(element)) return 0;
+            return encode_pointer_value(VALUE_STRING_TAG, element->content.string_value, to);
+        case ARRAY_TYPE:
+            return encode_pointer_value(VALUE_ARRAY_TAG, element->content.array_value, to);
+        case BLOCK_TYPE:
+            return encode_pointer_value(VALUE_BLOCK_TAG, element->content.block_value, to);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Lê um valor NaN-boxed como elemento. O elemento partilha o conteudo (strings, arrays, blocos) com o valor.
+ * @param value o valor
+ * @return O elemento
+ */
+static StackElement decode_value(Value value) {
+    StackElement element;
+    Value tag = value >> VALUE_TAG_SHIFT;
+
+    if (tag < VALUE_MIN_TAG) {
+        element.type = DOUBLE_TYPE;
+        element.content.double_value = get_double_value(value);
+        return element;
+    }
+
+    switch (tag) {
+        case VALUE_LONG_TAG:
+            element.type = LONG_TYPE;
+            element.content.long_value = get_long_value(value);
+            return element;
+        case VALUE_CHAR_TAG:
+            element.type = CHAR_TYPE;
+            element.content.char_value = (char) (value & 0xFF);
+            return element;
+        case VALUE_STRING_TAG:
+            element.type = STRING_TYPE;
+            element.short_string.length = LONG_STRING_MARKER;
+            element.content.string_value = get_value_pointer(value);
+            return element;
+        case VALUE_ARRAY_TAG:
+            element.type = ARRAY_TYPE;
+            element.content.array_value = get_value_pointer(value);
+            return element;
+        case VALUE_BLOCK_TAG:
+            element.type = BLOCK_TYPE;
+            element.content.block_value = get_value_pointer(value);
+            return element;
+        case VALUE_BOXED_LONG_TAG:
+            element.type = LONG_TYPE;
+            element.content.long_value = *(long *) get_value_pointer(value);
+            return element;
+        default: PANIC("Couldn't decode value 0x%lx\n", (unsigned long) value)
+    }
+}
+
+/**
+ * Lê um valor NaN-boxed como elemento, ficando o elemento com a posse do conteudo (o valor deixa de ser válido)
+ * @param value o valor
+ * @return O elemento
+ */
+static StackElement consume_value(Value value) {
+    StackElement element = decode_value(value);
+
+    if ((value >> VALUE_TAG_SHIFT) == VALUE_BOXED_LONG_TAG) free(get_value_pointer(value));
+
+    return element;
+}
+
+/**
+ * Lê a posição @param{index} de uma array. O elemento partilha o conteudo com a array.
+ * @param storage o armazenamento da array
+ * @param buffer a array
+ * @param index posição
+ * @return O elemento
+ */
+static StackElement read_slot(StackStorage storage, void *buffer, int index) {
+    switch (storage) {
+        case NAN_BOXED_STORAGE:
+            return decode_value(((Value *) buffer)[index]);
+        case LONG_STORAGE:
+            return create_long_element(((long *) buffer)[index]);
+        case DOUBLE_STORAGE:
+            return create_double_element(((double *) buffer)[index]);
+        case CHAR_STORAGE:
+            return create_char_element(((char *) buffer)[index]);
+        case BOXED_STORAGE:
+        default:
+            return ((StackElement *) buffer)[index];
+    }
+}
+
+/**
+ * Lê a posição @param{index} de uma array, ficando o elemento com a posse do conteudo (a posição deixa de ser válida)
+ * @param storage o armazenamento da array
+ * @param buffer a array
+ * @param index posição
+ * @return O elemento
+ */
+static StackElement take_slot(StackStorage storage, void *buffer, int index) {
+    if (storage == NAN_BOXED_STORAGE) return consume_value(((Value *) buffer)[index]);
+
+    return read_slot(storage, buffer, index);
+}
+
+/**
+ * Guarda um elemento na posição @param{index} de uma array, passando a posse do conteudo para a array
+ * @param storage o armazenamento da array
+ * @param buffer a array
+ * @param index posição
+ * @param element o elemento
+ * @return 1 se o elemento foi guardado, 0 se o armazenamento não suporta o elemento
+ */
+static int write_slot(StackStorage storage, void *buffer, int index, StackElement *element) {
+    switch (storage) {
+        case NAN_BOXED_STORAGE:
+            return encode_value(element, &((Value *) buffer)[index]);
+        case LONG_STORAGE:
+            if (element->type != LONG_TYPE) return 0;
+            ((long *) buffer)[index] = element->content.long_value;
+            return 1;
+        case DOUBLE_STORAGE:
+            if (element->type != DOUBLE_TYPE) return 0;
+            ((double *) buffer)[index] = element->content.double_value;
+            return 1;
+        case CHAR_STORAGE:
+            if (element->type != CHAR_TYPE) return 0;
+            ((char *) buffer)[index] = element->content.char_value;
+            return 1;
+        case BOXED_STORAGE:
+        default:
+            ((StackElement *) buffer)[index] = *element;
+            return 1;
+    }
+}
+
+/**
+ * @param storage um armazenamento
+ * @return 1 se o armazenamento é uma array sem tipos (long[], double[] ou char[])
+ */
+static int is_typed_storage(StackStorage storage) {
+    return storage == LONG_STORAGE || storage == DOUBLE_STORAGE || storage == CHAR_STORAGE;
+}
+
+/**
+ * Retorna o armazenamento para onde uma stack passa quando recebe um elemento que o seu armazenamento não suporta
+ * @param storage o armazenamento atual
+ * @return O armazenamento mais geral
+ */
+static StackStorage get_general_storage(StackStorage storage) {
+    return is_typed_storage(storage) ? GENERAL_STACK_STORAGE : BOXED_STORAGE;
+}
+
+/**
+ * Retorna o armazenamento de uma stack cujo primeiro elemento é do tipo @param{type}
+ * @param type tipo do primeiro elemento
+ * @return O armazenamento
+ */
+static StackStorage get_specialized_storage(ElementType type) {
+    switch (type) {
+        case LONG_TYPE:
+            return LONG_STORAGE;
+        case DOUBLE_TYPE:
+            return DOUBLE_STORAGE;
+        case CHAR_TYPE:
+            return CHAR_STORAGE;
+        case STRING_TYPE:
+        case ARRAY_TYPE:
+        case BLOCK_TYPE:
+        default:
+            return GENERAL_STACK_STORAGE;
+    }
+}
+
+/**
+ * Aloca a array de uma stack que ainda não tem array, com o armazenamento especializado para o primeiro elemento
+ * @param stack target
+ * @param type tipo do primeiro elemento
+ */
+static void allocate_specialized_buffer(Stack *stack, ElementType type) {
+    stack->storage = get_specialized_storage(type);
+    stack->buffer = allocate_stack_buffer(stack, get_buffer_size(stack->storage, stack->capacity));
+}
+
+/**
+ * Muda o armazenamento de uma stack, convertendo todos os seus elementos
+ * @param stack target
+ * @param storage o novo armazenamento (tem de suportar todos os elementos da stack)
+ */
+static void convert_storage(Stack *stack, StackStorage storage) {
+    StackStorage old_storage = stack->storage;
+    void *old_buffer = stack->buffer;
+
+    stack->storage = storage;
+    stack->buffer = allocate_stack_buffer(stack, get_buffer_size(storage, stack->capacity));
+
+    for (int i = 0; i < length(stack); i++) {
+        StackElement element = take_slot(old_storage, old_buffer, i);
+        write_slot(storage, stack->buffer, i, &element);
+    }
+
+    release_stack_buffer(stack, old_buffer, get_buffer_size(old_storage, stack->capacity));
+}
+
 void free_stack(Stack *stack) {
-    for (int i = 0; i < length(stack); ++i) {
-        free_element(stack->array[i]);
+    if (--stack->reference_count > 0) return;
+
+    if (!is_typed_storage(stack->storage)) {
+        for (int i = 0; i < length(stack); ++i) {
+            free_element(take_slot(stack->storage, stack->buffer, i));
+        }
+    }
+
+    release_stack_buffer(stack, stack->buffer, get_buffer_size(stack->storage, stack->capacity));
+
+    if (stack->arena == NULL) pool_release(&free_stack_headers, stack);
+}
+
+/**
+ * Liberta todos os blocos de uma lista livre
+ * @param list lista livre
+ */
+static void free_pool_list(StackPoolFreeList *list) {
+    while (list->head != NULL) {
+        void *block = list->head;
+        list->head = *(void **) block;
+        free(block);
+    }
+    list->count = 0;
+}
+
+void free_stack_pool(void) {
+    free_pool_list(&free_stack_headers);
+
+    for (int i = 0; i < STACK_POOL_SIZE_CLASSES; i++) {
+        free_pool_list(&free_stack_buffers[i]);
     }
+}
 
-    free(stack->array);
-    free(stack);
+StackPoolStats get_stack_pool_stats(void) {
+    return stack_pool_stats;
 }
 
 void dump_element(StackElement *element) {
@@ -42,7 +716,7 @@ void dump_element(StackElement *element) {
             printf("%g", element->content.double_value);
             return;
         case STRING_TYPE:
-            printf("%s", element->content.string_value);
+            fwrite(get_string_value(element), sizeof(char), get_string_length(element), stdout);
             return;
         case ARRAY_TYPE:
             dump_stack(element->content.array_value);
@@ -56,7 +730,8 @@ void dump_element(StackElement *element) {
 
 void dump_stack(Stack *stack) {
     for (int i = 0; i < length(stack); ++i) {
-        dump_element(&stack->array[i]);
+        StackElement element = get_element_at(stack, i);
+        dump_element(&element);
     }
 }
 
@@ -67,13 +742,100 @@ int length(Stack *stack) {
 StackElement pop(Stack *stack) {
     if (length(stack) <= 0) PANIC("Trying to pop from empty stack")
 
-    StackElement result = stack->array[stack->current_index];
-    stack->current_index--;
+    int index = stack->current_index--;
 
-    return result;
+    return take_slot(stack->storage, stack->buffer, index);
+}
+
+int pop_two_longs(Stack *stack, long *x, long *y) {
+    if (length(stack) < 2) return 0;
+
+    int index = stack->current_index;
+
+    switch (stack->storage) {
+        case LONG_STORAGE:
+            *x = stack->longs[index - 1];
+            *y = stack->longs[index];
+            break;
+        case NAN_BOXED_STORAGE:
+            if (!is_long_value(stack->values[index - 1]) || !is_long_value(stack->values[index])) return 0;
+
+            *x = get_long_value(stack->values[index - 1]);
+            *y = get_long_value(stack->values[index]);
+            break;
+        case BOXED_STORAGE:
+            if (stack->array[index - 1].type != LONG_TYPE || stack->array[index].type != LONG_TYPE) return 0;
+
+            *x = stack->array[index - 1].content.long_value;
+            *y = stack->array[index].content.long_value;
+            break;
+        case DOUBLE_STORAGE:
+        case CHAR_STORAGE:
+        default:
+            return 0;
+    }
+
+    stack->current_index -= 2;
+    return 1;
+}
+
+int pop_two_doubles(Stack *stack, double *x, double *y) {
+    if (length(stack) < 2) return 0;
+
+    int index = stack->current_index;
+    Value x_value, y_value;
+    StackElement *x_element, *y_element;
+
+    switch (stack->storage) {
+        case DOUBLE_STORAGE:
+            *x = stack->doubles[index - 1];
+            *y = stack->doubles[index];
+            break;
+        case NAN_BOXED_STORAGE:
+            x_value = stack->values[index - 1];
+            y_value = stack->values[index];
+
+            if (!(is_double_value(x_value) && (is_double_value(y_value) || is_long_value(y_value)))
+                && !(is_long_value(x_value) && is_double_value(y_value))) {
+                return 0;
+            }
+
+            *x = is_double_value(x_value) ? get_double_value(x_value) : (double) get_long_value(x_value);
+            *y = is_double_value(y_value) ? get_double_value(y_value) : (double) get_long_value(y_value);
+            break;
+        case BOXED_STORAGE:
+            x_element = &stack->array[index - 1];
+            y_element = &stack->array[index];
+
+            if (!(x_element->type == DOUBLE_TYPE && (y_element->type == DOUBLE_TYPE || y_element->type == LONG_TYPE))
+                && !(x_element->type == LONG_TYPE && y_element->type == DOUBLE_TYPE)) {
+                return 0;
+            }
+
+            *x = x_element->type == DOUBLE_TYPE ? x_element->content.double_value
+                                                : (double) x_element->content.long_value;
+            *y = y_element->type == DOUBLE_TYPE ? y_element->content.double_value
+                                                : (double) y_element->content.long_value;
+            break;
+        case LONG_STORAGE:
+        case CHAR_STORAGE:
+        default:
+            return 0;
+    }
+
+    stack->current_index -= 2;
+    return 1;
 }
 
 long pop_long(Stack *stack) {
+    if (length(stack) > 0) {
+        if (stack->storage == LONG_STORAGE) return stack->longs[stack->current_index--];
+
+        if (stack->storage == NAN_BOXED_STORAGE && is_long_value(stack->values[stack->current_index])) {
+            return get_long_value(stack->values[stack->current_index--]);
+        }
+    }
+
     StackElement element = pop(stack);
     long value = element.content.long_value;
 
@@ -81,36 +843,100 @@ long pop_long(Stack *stack) {
     return value;
 }
 
+/**
+ * Duplica a capacidade da stack caso esteja cheia
+ * @param stack target
+ */
+static void grow_if_full(Stack *stack) {
+    if (length(stack) < stack->capacity) return;
+
+    size_t old_size = get_buffer_size(stack->storage, stack->capacity);
+    void *buffer = allocate_stack_buffer(stack, old_size * 2);
+    memcpy(buffer, stack->buffer, (unsigned long) length(stack) * get_storage_element_size(stack->storage));
+    release_stack_buffer(stack, stack->buffer, old_size);
+
+    stack->buffer = buffer;
+    stack->capacity *= 2;
+
+    PRINT_DEBUG("REALLOCATED STACK (new capacity = %d)\n", stack->capacity)
+}
+
+/**
+ * Prepara a stack para receber um elemento do tipo @param{type} no topo: aloca a array caso ainda não exista
+ * e aumenta a capacidade caso esteja cheia
+ * @param stack target
+ * @param type tipo do elemento
+ */
+static void prepare_push(Stack *stack, ElementType type) {
+    if (stack->buffer == NULL) {
+        allocate_specialized_buffer(stack, type);
+    } else {
+        grow_if_full(stack);
+    }
+}
+
 void push(Stack *stack, StackElement x) {
-    if (length(stack) >= stack->capacity) {
-        stack->capacity *= 2;
-        stack->array = realloc(stack->array, (unsigned long) stack->capacity * sizeof(StackElement));
-        PRINT_DEBUG("REALLOCATED STACK (new capacity = %d)\n", stack->capacity)
+    prepare_push(stack, x.type);
+
+    while (!write_slot(stack->storage, stack->buffer, stack->current_index + 1, &x)) {
+        convert_storage(stack, get_general_storage(stack->storage));
     }
 
-    stack->array[++(stack->current_index)] = x;
+    stack->current_index++;
 }
 
 void push_all(Stack *stack, Stack *elements) {
     int elements_length = length(elements);
     for (int i = 0; i < elements_length; ++i) {
-        push(stack, duplicate_element(elements->array[i]));
+        push(stack, duplicate_element(get_element_at(elements, i)));
+    }
+}
+
+void move_all(Stack *stack, Stack *elements) {
+    int elements_length = length(elements);
+    for (int i = 0; i < elements_length; ++i) {
+        push(stack, take_slot(elements->storage, elements->buffer, i));
     }
+    elements->current_index = -1;
 }
 
 void push_double(Stack *stack, double value) {
-    push(stack, create_double_element(value));
+    prepare_push(stack, DOUBLE_TYPE);
+
+    if (stack->storage == DOUBLE_STORAGE) {
+        stack->doubles[++(stack->current_index)] = value;
+    } else if (stack->storage == NAN_BOXED_STORAGE) {
+        stack->values[++(stack->current_index)] = create_double_value(value);
+    } else {
+        push(stack, create_double_element(value));
+    }
 }
 
 void push_long(Stack *stack, long value) {
-    push(stack, create_long_element(value));
+    prepare_push(stack, LONG_TYPE);
+
+    if (stack->storage == LONG_STORAGE) {
+        stack->longs[++(stack->current_index)] = value;
+    } else if (stack->storage == NAN_BOXED_STORAGE && long_fits_in_value(value)) {
+        stack->values[++(stack->current_index)] = make_value(VALUE_LONG_TAG, (Value) value);
+    } else {
+        push(stack, create_long_element(value));
+    }
 }
 
 void push_char(Stack *stack, char value) {
-    push(stack, create_char_element(value));
+    prepare_push(stack, CHAR_TYPE);
+
+    if (stack->storage == CHAR_STORAGE) {
+        stack->chars[++(stack->current_index)] = value;
+    } else if (stack->storage == NAN_BOXED_STORAGE) {
+        stack->values[++(stack->current_index)] = make_value(VALUE_CHAR_TAG, (unsigned char) value);
+    } else {
+        push(stack, create_char_element(value));
+    }
 }
 
-void push_string(Stack *stack, char *value) {
+void push_string(Stack *stack, const char *value) {
     push(stack, create_string_element(value));
 }
 
@@ -146,19 +972,74 @@ StackElement create_char_element(char value) {
     return element;
 }
 
-StackElement create_string_element(char *value) {
-    StackElement element;
-    element.type = STRING_TYPE;
+StackElement create_string_element(const char *value) {
+    return create_string_element_with_length(value, strlen(value));
+}
+
+StackElement create_string_element_with_length(const char *value, size_t length) {
+    StackElement element = allocate_string_element(length);
+    memcpy(get_string_value(&element), value, length);
 
-    size_t length = strlen(value) + 1;
-    char *copied_string = calloc(length, sizeof(char));
-    strcpy(copied_string, value);
+    return element;
+}
+
+StackElement allocate_string_element(size_t length) {
+    StackElement element;
 
-    element.content.string_value = copied_string;
+    if (length < SHORT_STRING_BUFFER_SIZE) {
+        element.short_string.type = STRING_TYPE;
+        element.short_string.length = (unsigned char) length;
+        element.short_string.value[length] = '\0';
+    } else {
+        element.type = STRING_TYPE;
+        element.short_string.length = LONG_STRING_MARKER;
+        element.content.string_value = allocate_shared_string(length);
+    }
 
     return element;
 }
 
+char *get_string_value(StackElement *element) {
+    return is_short_string(element) ? element->short_string.value : element->content.string_value;
+}
+
+size_t get_string_length(StackElement *element) {
+    return is_short_string(element)
+           ? element->short_string.length
+           : get_shared_string_header(element->content.string_value)->length;
+}
+
+void append_to_string_element(StackElement *element, const char *value, size_t length) {
+    size_t old_length = get_string_length(element);
+    size_t new_length = old_length + length;
+
+    if (is_short_string(element) && new_length < SHORT_STRING_BUFFER_SIZE) {
+        memcpy(element->short_string.value + old_length, value, length);
+        element->short_string.value[new_length] = '\0';
+        element->short_string.length = (unsigned char) new_length;
+        return;
+    }
+
+    char *string = get_string_value(element);
+
+    if (is_short_string(element)
+        || get_shared_string_header(string)->reference_count > 1
+        || get_shared_string_header(string)->capacity < new_length) {
+        char *grown_string = allocate_shared_string_with_capacity(old_length, new_length * 2);
+        memcpy(grown_string, string, old_length);
+
+        free_element(*element);
+        element->type = STRING_TYPE;
+        element->short_string.length = LONG_STRING_MARKER;
+        element->content.string_value = grown_string;
+        string = grown_string;
+    }
+
+    memcpy(string + old_length, value, length);
+    string[new_length] = '\0';
+    get_shared_string_header(string)->length = new_length;
+}
+
 StackElement create_array_element(Stack *value) {
     StackElement element;
     element.type = ARRAY_TYPE;
@@ -167,33 +1048,87 @@ StackElement create_array_element(Stack *value) {
     return element;
 }
 
-StackElement create_block_element(char *value) {
+StackElement create_block_element(const char *value) {
     StackElement element;
     element.type = BLOCK_TYPE;
-
-    size_t length = strlen(value) + 1;
-    char *copied_string = calloc(length, sizeof(char));
-    strcpy(copied_string, value);
-
-    element.content.block_value = copied_string;
+    element.content.block_value = create_shared_string(value, strlen(value));
 
     return element;
 }
 
 StackElement peek(Stack *stack) {
-    return stack->array[stack->current_index];
+    if (length(stack) <= 0) PANIC("Trying to peek from empty stack")
+
+    return get_element_at(stack, stack->current_index);
 }
 
 StackElement get(Stack *stack, long index) {
-    return stack->array[stack->current_index - index];
+    if (index < 0 || index >= length(stack)) PANIC("Trying to get element %ld from stack with %d elements", index,
+                                                   length(stack))
+
+    return get_element_at(stack, (int) (stack->current_index - index));
 }
 
-/**
- * Retorna 1 se a string conter apenas whitespaces, 0 caso contrário
- * @param s string para testar
- * @return Valor booleano
- */
-static int string_only_contains_whitespaces(const char *s) {
+int is_element_type(Stack *stack, long index, ElementType type) {
+    if (index < 0 || index >= length(stack)) return 0;
+
+    // Nos storages tipados o tipo de todos os elementos é dado pelo storage
+    switch (stack->storage) {
+        case LONG_STORAGE:
+            return type == LONG_TYPE;
+        case DOUBLE_STORAGE:
+            return type == DOUBLE_TYPE;
+        case CHAR_STORAGE:
+            return type == CHAR_TYPE;
+        case BOXED_STORAGE:
+        case NAN_BOXED_STORAGE:
+        default:
+            return get_element_at(stack, (int) (stack->current_index - index)).type == type;
+    }
+}
+
+StackElement get_element_at(Stack *stack, int index) {
+    return read_slot(stack->storage, stack->buffer, index);
+}
+
+Stack *copy_stack_range(Stack *stack, int start, int count) {
+    Stack *copy = create_stack(count);
+
+    if (count <= 0) return copy;
+
+    if (is_typed_storage(stack->storage)) {
+        size_t element_size = get_storage_element_size(stack->storage);
+
+        copy->storage = stack->storage;
+        copy->buffer = allocate_stack_buffer(copy, get_buffer_size(copy->storage, copy->capacity));
+        memcpy(copy->buffer, (char *) stack->buffer + (size_t) start * element_size, (size_t) count * element_size);
+        copy->current_index = count - 1;
+
+        return copy;
+    }
+
+    for (int i = start; i < start + count; i++) {
+        push(copy, duplicate_element(get_element_at(stack, i)));
+    }
+
+    return copy;
+}
+
+void permute_stack(Stack *stack, const int *order) {
+    size_t element_size = get_storage_element_size(stack->storage);
+    size_t size = get_buffer_size(stack->storage, stack->capacity);
+    char *old_buffer = stack->buffer;
+    char *buffer = allocate_stack_buffer(stack, size);
+
+    for (int i = 0; i < length(stack); i++) {
+        memcpy(buffer + (size_t) i * element_size, old_buffer + (size_t) order[i] * element_size, element_size);
+    }
+
+    release_stack_buffer(stack, old_buffer, size);
+    stack->buffer = buffer;
+}
+
+int string_only_contains_whitespaces(const char *s) {
     while (*s != '\0') {
         if (!isspace(*s)) return 0;
         s++;
@@ -208,7 +1143,7 @@ int is_truthy(StackElement *a) {
         case CHAR_TYPE:
             return a->content.char_value != '\0';
         case STRING_TYPE:
-            return strlen(a->content.string_value) != 0;
+            return get_string_length(a) != 0;
         case DOUBLE_TYPE:
             return a->content.double_value != .0;
         case ARRAY_TYPE:
@@ -222,13 +1157,13 @@ int is_truthy(StackElement *a) {
 void free_element(StackElement element) {
     switch (element.type) {
         case STRING_TYPE:
-            free(element.content.string_value);
+            if (!is_short_string(&element)) release_shared_string(element.content.string_value);
             return;
         case ARRAY_TYPE:
             free_stack(element.content.array_value);
             return;
         case BLOCK_TYPE:
-            free(element.content.block_value);
+            release_shared_string(element.content.block_value);
             return;
         case LONG_TYPE:
         case CHAR_TYPE:
@@ -240,21 +1175,54 @@ void free_element(StackElement element) {
 
 StackElement duplicate_array(StackElement element) {
     Stack *old_array = element.content.array_value;
-    Stack *new_array = create_stack(old_array->capacity);
-    for (int i = 0; i < length(old_array); i++) {
-        push(new_array, duplicate_element(old_array->array[i]));
-    }
-    return create_array_element(new_array);
+    return create_array_element(copy_stack_range(old_array, 0, length(old_array)));
+}
+
+/**
+ * Retorna os caracteres partilhados de um elemento string ou bloco
+ * @param element o elemento
+ * @return Os caracteres, NULL se o elemento não tem uma string partilhada
+ */
+static char *get_shared_string_of(StackElement *element) {
+    if (element->type == STRING_TYPE && !is_short_string(element)) return element->content.string_value;
+    if (element->type == BLOCK_TYPE) return element->content.block_value;
+
+    return NULL;
+}
+
+StackElement make_immortal_element(StackElement element) {
+    char *string = get_shared_string_of(&element);
+    if (string != NULL) get_shared_string_header(string)->reference_count = IMMORTAL_REFERENCE_COUNT;
+
+    return element;
+}
+
+int needs_reference_count(StackElement *element) {
+    if (element->type == ARRAY_TYPE) return 1;
+
+    char *string = get_shared_string_of(element);
+
+    return string != NULL && get_shared_string_header(string)->reference_count != IMMORTAL_REFERENCE_COUNT;
+}
+
+void free_immortal_element(StackElement element) {
+    char *string = get_shared_string_of(&element);
+    if (string != NULL) get_shared_string_header(string)->reference_count = 1;
+
+    free_element(element);
 }
 
 StackElement duplicate_element(StackElement element) {
     switch (element.type) {
         case STRING_TYPE:
-            return create_string_element(element.content.string_value);
+            if (!is_short_string(&element)) retain_shared_string(element.content.string_value);
+            return element;
         case ARRAY_TYPE:
-            return duplicate_array(element);
+            element.content.array_value->reference_count++;
+            return element;
         case BLOCK_TYPE:
-            return create_block_element(element.content.block_value);
+            retain_shared_string(element.content.block_value);
+            return element;
         case LONG_TYPE:
         case CHAR_TYPE:
         case DOUBLE_TYPE:
@@ -262,3 +1230,27 @@ StackElement duplicate_element(StackElement element) {
             return element;
     }
 }
+
+Stack *get_mutable_array(StackElement *element) {
+    Stack *array = element->content.array_value;
+
+    if (array->reference_count > 1) {
+        *element = duplicate_array(*element);
+        free_stack(array);
+    }
+
+    return element->content.array_value;
+}
+
+char *get_mutable_string(StackElement *element) {
+    if (is_short_string(element)) return element->short_string.value;
+
+    char *string = element->content.string_value;
+
+    if (get_shared_string_header(string)->reference_count > 1) {
+        *element = create_string_element_with_length(string, get_string_length(element));
+        release_shared_string(string);
+    }
+
+    return get_string_value(element);
+}
@@ -5,10 +5,23 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/**
+ * Ocupa apenas um byte (quando o compilador o permite) para sobrar mais espaço para as strings curtas
+ */
+#if defined(__GNUC__)
+#define PACKED_ENUM __attribute__((packed))
+#else
+#define PACKED_ENUM
+#endif
+
 /**
  * @brief Enum dos tipos de elementos existentes
  */
-typedef enum {
+typedef enum PACKED_ENUM {
     /** Tipo double */
     DOUBLE_TYPE,
     /** Tipo inteiro */
@@ -29,53 +42,158 @@ typedef enum {
 typedef struct stack Stack;
 
 /**
- * Struct de um elemento da stack
- */
-typedef struct {
-    /** Tipo do elemento */
-    ElementType type;
-    /** Union do conteudo do elemento */
-    union {
-        /** Valor double */
-        double double_value;
-        /** Valor inteiro */
-        long long_value;
-        /** Valor caractere */
-        char char_value;
-        /** Valor string */
-        char *string_value;
-        /** Valor array */
-        Stack *array_value;
-        /** Valor bloco */
-        char *block_value;
-    } content;
+ * Tamanho do buffer das strings curtas guardadas dentro do próprio elemento (incluindo o '\0')
+ */
+#define SHORT_STRING_BUFFER_SIZE (2 * sizeof(long) - sizeof(ElementType) - sizeof(unsigned char))
+
+/**
+ * Valor de short_string.length que indica que a string está guardada fora do elemento (em content.string_value)
+ */
+#define LONG_STRING_MARKER 0xFF
+
+/**
+ * Struct de um elemento da stack.
+ * O conteudo das strings, blocos e arrays é partilhado entre cópias (com contagem de referências) e só é
+ * copiado quando é alterado (copy-on-write).
+ * As strings com menos de SHORT_STRING_BUFFER_SIZE caracteres são guardadas dentro do elemento (short_string).
+ * O conteudo das strings deve ser acedido com get_string_value e get_string_length.
+ */
+typedef union {
+    struct {
+        /** Tipo do elemento */
+        ElementType type;
+        /** Union do conteudo do elemento */
+        union {
+            /** Valor double */
+            double double_value;
+            /** Valor inteiro */
+            long long_value;
+            /** Valor caractere */
+            char char_value;
+            /** Valor string (quando não é uma string curta) */
+            char *string_value;
+            /** Valor array */
+            Stack *array_value;
+            /** Valor bloco */
+            char *block_value;
+        } content;
+    };
+    /** String curta guardada dentro do elemento */
+    struct {
+        /** Tipo do elemento (STRING_TYPE) */
+        ElementType type;
+        /** Tamanho da string, ou LONG_STRING_MARKER se a string não está guardada dentro do elemento */
+        unsigned char length;
+        /** Caracteres da string (terminados em '\0') */
+        char value[SHORT_STRING_BUFFER_SIZE];
+    } short_string;
 } StackElement;
 
+/**
+ * Valor NaN-boxed: um elemento (sem strings curtas) codificado em 64 bits.
+ * Os doubles são guardados tal como são e os outros tipos no payload de um NaN.
+ */
+typedef uint64_t Value;
+
+/**
+ * @brief Enum das formas de guardar os elementos de uma stack.
+ * O armazenamento é escolhido pelo tipo do primeiro elemento e passa para um mais geral
+ * (tipado -> NAN_BOXED_STORAGE -> BOXED_STORAGE) quando recebe um elemento que não suporta.
+ */
+typedef enum {
+    /** Array de StackElement, suporta qualquer elemento */
+    BOXED_STORAGE,
+    /** Array de Value (8 bytes por elemento), suporta todos os elementos menos as strings curtas */
+    NAN_BOXED_STORAGE,
+    /** Array de long, só com longs */
+    LONG_STORAGE,
+    /** Array de double, só com doubles */
+    DOUBLE_STORAGE,
+    /** Array de char, só com chars */
+    CHAR_STORAGE
+} StackStorage;
+
 /**
  * Definição do struct da stack com implementação de array dinâmica
  */
 typedef struct stack {
+    /** Número de referências para a stack (as cópias de um elemento array partilham a mesma stack) */
+    int reference_count;
     /** Capacidade atual da stack */
     int capacity;
     /** Indice do último elemento adicionado (Começa em -1) */
     int current_index;
-    /** Array dos elementos */
-    StackElement *array;
+    /** Forma como os elementos estão guardados */
+    StackStorage storage;
+    /** Array dos elementos (NULL até ao primeiro push), deve ser acedida com get_element_at */
+    union {
+        /** Memória da array */
+        void *buffer;
+        /** Array dos elementos (BOXED_STORAGE) */
+        StackElement *array;
+        /** Array dos valores (NAN_BOXED_STORAGE) */
+        Value *values;
+        /** Array dos longs (LONG_STORAGE) */
+        long *longs;
+        /** Array dos doubles (DOUBLE_STORAGE) */
+        double *doubles;
+        /** Array dos chars (CHAR_STORAGE) */
+        char *chars;
+    };
+    /** Arena onde a stack e a primeira array estão alocadas, ou NULL se foram alocadas com malloc */
+    Arena *arena;
+    /** 1 se a array atual está na arena (as arrays seguintes vêm da pool, ver allocate_stack_buffer) */
+    int is_buffer_in_arena;
 } Stack;
 
 /**
- * Cria e aloca uma stack na memória
+ * Contadores da pool de stacks (cabeçalhos e arrays de elementos reaproveitados)
+ */
+typedef struct {
+    /** Número de cabeçalhos pedidos */
+    unsigned long header_requests;
+    /** Número de cabeçalhos reaproveitados da pool */
+    unsigned long header_hits;
+    /** Número de arrays de elementos pedidas */
+    unsigned long buffer_requests;
+    /** Número de arrays de elementos reaproveitadas da pool */
+    unsigned long buffer_hits;
+} StackPoolStats;
+
+/**
+ * Cria e aloca uma stack na memória.
+ * O cabeçalho e a array de elementos são reaproveitados de stacks libertadas (pool com listas livres
+ * por classe de tamanho), a capacidade é arredondada para a próxima potência de 2.
  * @param initial_capacity capacidade incial
  * @return Um pointer para a stack
  */
 Stack *create_stack(int initial_capacity);
 
 /**
- * Libera a memória ocupada pela stack
+ * Cria uma stack temporária alocada numa arena.
+ * free_stack liberta apenas os elementos, a memória da stack é libertada com arena_release.
+ * @param arena arena onde alocar a stack
+ * @param initial_capacity capacidade incial
+ * @return Um pointer para a stack
+ */
+Stack *create_stack_in_arena(Arena *arena, int initial_capacity);
+
+/**
+ * Liberta uma referência para a stack, a memória é libertada quando não restam referências
  * @param stack
  */
 void free_stack(Stack *stack);
 
+/**
+ * Liberta a memória guardada pela pool de stacks
+ */
+void free_stack_pool(void);
+
+/**
+ * @return Os contadores da pool de stacks
+ */
+StackPoolStats get_stack_pool_stats(void);
+
 /**
  * Faz print de todos os elementos da stack
  * @param stack target
@@ -102,6 +220,24 @@ int length(Stack *stack);
  */
 StackElement pop(Stack *stack);
 
+/**
+ * Remove os dois últimos elementos da stack caso ambos sejam longs, sem passar pelos elementos
+ * @param stack target
+ * @param x onde guardar o penúltimo elemento
+ * @param y onde guardar o último elemento
+ * @return 1 se os elementos foram removidos, 0 caso contrário (a stack não é alterada)
+ */
+int pop_two_longs(Stack *stack, long *x, long *y);
+
+/**
+ * Remove os dois últimos elementos da stack caso sejam doubles ou longs e pelo menos um seja double
+ * @param stack target
+ * @param x onde guardar o penúltimo elemento (convertido para double)
+ * @param y onde guardar o último elemento (convertido para double)
+ * @return 1 se os elementos foram removidos, 0 caso contrário (a stack não é alterada)
+ */
+int pop_two_doubles(Stack *stack, double *x, double *y);
+
 /**
  * Faz pop da stack e converte o valor para long
  * @param stack target
@@ -123,6 +259,13 @@ void push(Stack *stack, StackElement x);
  */
 void push_all(Stack *stack, Stack *elements);
 
+/**
+ * Move todos os elementos de uma stack para a @param{stack} (sem os copiar), deixando @param{elements} vazia
+ * @param stack target
+ * @param elements elementos para mover
+ */
+void move_all(Stack *stack, Stack *elements);
+
 /**
  * Faz push de um double para a @param{stack}
  * @param stack target
@@ -149,7 +292,7 @@ void push_char(Stack *stack, char value);
  * @param stack target
  * @param value valor string
  */
-void push_string(Stack *stack, char *value);
+void push_string(Stack *stack, const char *value);
 
 /**
  * Faz push de uma array para a @param{stack}
@@ -166,6 +309,7 @@ void push_array(Stack *stack, Stack *value);
 void push_block(Stack *stack, char *value);
 
 /**
+ * Aborta o programa se a stack estiver vazia
  * @param stack target
  * @return O ultimo elemento adicionado à stack sem o remover
  */
@@ -173,13 +317,49 @@ StackElement peek(Stack *stack);
 
 /**
  * Retorna o elemento da stack que está no indice @param{index}
- * O indice 0 é o ultimo elemento adicionado.
+ * O indice 0 é o ultimo elemento adicionado. Aborta o programa se a stack não tiver esse elemento.
  * @param stack target
  * @param index indice
  * @return O elemento do indice
  */
 StackElement get(Stack *stack, long index);
 
+/**
+ * Verifica se a stack tem um elemento no indice @param{index} (0 é o ultimo elemento adicionado) e se é do tipo
+ * @param{type}. Usado pelas operações polimorfas para escolherem a operação sem lerem fora da stack.
+ * @param stack target
+ * @param index indice
+ * @param type tipo
+ * @return 1 se o elemento existe e é do tipo, 0 caso contrário
+ */
+int is_element_type(Stack *stack, long index, ElementType type);
+
+/**
+ * Retorna o elemento da stack que está na posição @param{index} a contar do início (0 é o primeiro elemento).
+ * O elemento continua a pertencer à stack (usar duplicate_element para ficar com uma cópia).
+ * @param stack target
+ * @param index posição
+ * @return O elemento
+ */
+StackElement get_element_at(Stack *stack, int index);
+
+/**
+ * Cria uma stack com cópias dos elementos de @param{stack} nas posições [@param{start}, @param{start} + @param{count}).
+ * As arrays tipadas são copiadas diretamente (mantendo o armazenamento).
+ * @param stack target
+ * @param start primeira posição
+ * @param count número de elementos
+ * @return A nova stack
+ */
+Stack *copy_stack_range(Stack *stack, int start, int count);
+
+/**
+ * Reordena os elementos da stack: a posição i passa a ter o elemento que estava na posição @param{order}[i]
+ * @param stack target
+ * @param order permutação das posições 0 até length(stack) - 1
+ */
+void permute_stack(Stack *stack, const int *order);
+
 /**
  * Cria um elemento do tipo double.
  * @param value double
@@ -207,7 +387,49 @@ StackElement create_char_element(char value);
  * @param value string
  * @return O elemento criado
  */
-StackElement create_string_element(char *value);
+StackElement create_string_element(const char *value);
+
+/**
+ * Cria um elemento do tipo string com os primeiros @param{length} caracteres de @param{value}.
+ * @param value string
+ * @param length número de caracteres a copiar
+ * @return O elemento criado
+ */
+StackElement create_string_element_with_length(const char *value, size_t length);
+
+/**
+ * Cria um elemento do tipo string com @param{length} caracteres por preencher (o '\0' final já é colocado).
+ * Os caracteres devem ser escritos em get_string_value.
+ * @param length tamanho da string
+ * @return O elemento criado
+ */
+StackElement allocate_string_element(size_t length);
+
+/**
+ * Retorna os caracteres (terminados em '\0') de um elemento string.
+ * A string pode conter '\0' antes do fim, o seu tamanho é dado por get_string_length.
+ * Para strings curtas o pointer aponta para dentro do próprio elemento.
+ * @param element elemento string
+ * @return Os caracteres da string
+ */
+char *get_string_value(StackElement *element);
+
+/**
+ * Retorna o tamanho de um elemento string em tempo constante
+ * @param element elemento string
+ * @return O tamanho da string
+ */
+size_t get_string_length(StackElement *element);
+
+/**
+ * Acrescenta os primeiros @param{length} caracteres de @param{value} ao fim de um elemento string.
+ * A string é alterada no próprio elemento (copy-on-write) e a sua capacidade cresce para o dobro quando não chega,
+ * por isso acrescentar repetidamente à mesma string tem custo amortizado proporcional ao que é acrescentado.
+ * @param element elemento string
+ * @param value caracteres a acrescentar
+ * @param length número de caracteres
+ */
+void append_to_string_element(StackElement *element, const char *value, size_t length);
 
 /**
  * Cria um elemento do tipo array.
@@ -222,7 +444,14 @@ StackElement create_array_element(Stack *value);
  * @param value bloco
  * @return O elemento criado
  */
-StackElement create_block_element(char *value);
+StackElement create_block_element(const char *value);
+
+/**
+ * Retorna 1 se a string conter apenas whitespaces (segundo isspace, como o parser), 0 caso contrário
+ * @param s string para testar
+ * @return Valor booleano
+ */
+int string_only_contains_whitespaces(const char *s);
 
 /**
  * Verifica o valor booleano de um elemento
@@ -238,15 +467,55 @@ int is_truthy(StackElement *a);
 void free_element(StackElement element);
 
 /**
- * Deep copy de um elemento
+ * Torna imortal a string partilhada de um elemento string ou bloco: duplicate_element e free_element deixam de
+ * alterar o seu contador de referências, por isso o elemento pode ser lido por várias threads ao mesmo tempo.
+ * Usado nos literais dos blocos compilados, que vivem até o bloco ser libertado.
+ * @param element o elemento
+ * @return O elemento
+ */
+StackElement make_immortal_element(StackElement element);
+
+/**
+ * Verifica se copiar ou libertar o elemento altera um contador de referências (arrays e strings/blocos partilhados
+ * que não são imortais)
+ * @param element o elemento
+ * @return 1 se o elemento tem contador de referências, 0 caso contrário
+ */
+int needs_reference_count(StackElement *element);
+
+/**
+ * Liberta um elemento tornado imortal com make_immortal_element
+ * @param element o elemento
+ */
+void free_immortal_element(StackElement element);
+
+/**
+ * Cópia de um elemento em tempo constante.
+ * O conteudo das strings, blocos e arrays passa a ser partilhado pelos dois elementos.
  * @param element elemento a ser copiado
- * @return O elemento deep copied
+ * @return A cópia do elemento
  */
 StackElement duplicate_element(StackElement element);
 
 /**
- * Deep copy de arrays
+ * Cópia de arrays, os elementos passam a ser partilhados pelas duas arrays
  * @param element elemento array a ser copiado
- * @return A array deep copied
+ * @return A array copiada
  */
 StackElement duplicate_array(StackElement element);
+
+/**
+ * Retorna a array de um elemento array pronta a ser alterada.
+ * Caso a array seja partilhada com outros elementos, o elemento passa a ter uma cópia só dele (copy-on-write).
+ * @param element elemento array
+ * @return A array que pode ser alterada
+ */
+Stack *get_mutable_array(StackElement *element);
+
+/**
+ * Retorna a string de um elemento string pronta a ser alterada.
+ * Caso a string seja partilhada com outros elementos, o elemento passa a ter uma cópia só dele (copy-on-write).
+ * @param element elemento string
+ * @return A string que pode ser alterada
+ */
+char *get_mutable_string(StackElement *element);
@@ -6,20 +6,14 @@
 #include <string.h>
 #include "string_operations.h"
 
-int parse_string(Stack *stack, char *word) {
-    size_t word_length = strlen(word);
+int compare_string_elements(StackElement *a, StackElement *b) {
+    size_t a_length = get_string_length(a);
+    size_t b_length = get_string_length(b);
 
-    if (*word != '"' || word[word_length - 1] != '"') {
-        return 0;
-    }
+    int return_value = memcmp(get_string_value(a), get_string_value(b), a_length < b_length ? a_length : b_length);
+    if (return_value != 0) return return_value;
 
-    // remover aspas
-    word[word_length - 1] = '\0';
-    word++;
-
-    push_string(stack, word);
-
-    return 1;
+    return (a_length > b_length) - (a_length < b_length);
 }
 
 /**
@@ -31,7 +25,7 @@ int string_compare_base(Stack *stack) {
     StackElement fst_element = pop(stack);
     StackElement snd_element = pop(stack);
 
-    int return_value = strcmp(snd_element.content.string_value, fst_element.content.string_value);
+    int return_value = compare_string_elements(&snd_element, &fst_element);
 
     free_element(fst_element);
     free_element(snd_element);
@@ -62,7 +56,7 @@ void string_compare_smaller_value_operation(Stack *stack) {
     StackElement fst_element = pop(stack);
     StackElement snd_element = pop(stack);
 
-    int return_value = strcmp(snd_element.content.string_value, fst_element.content.string_value);
+    int return_value = compare_string_elements(&snd_element, &fst_element);
 
     push(stack, return_value < 0 ? fst_element : snd_element);
     free_element(return_value < 0 ? snd_element : fst_element);
@@ -72,7 +66,7 @@ void string_compare_bigger_value_operation(Stack *stack) {
     StackElement fst_element = pop(stack);
     StackElement snd_element = pop(stack);
 
-    int return_value = strcmp(snd_element.content.string_value, fst_element.content.string_value);
+    int return_value = compare_string_elements(&snd_element, &fst_element);
 
     push(stack, return_value > 0 ? fst_element : snd_element);
     free_element(return_value > 0 ? snd_element : fst_element);
@@ -8,12 +8,12 @@
 #include "stack.h"
 
 /**
- * Tenta dar parse a uma string. Caso @param{string} começe e acabe com aspas, adiciona o conteudo interior das aspas como string à stack
- * @param stack A stack para adicionar a string
- * @param string A string input
- * @return 1 caso tenha conseguido parsear a string, 0 caso contrário
+ * @brief Compara dois elementos string pela ordem lexicográfica, usando os seus tamanhos (sem procurar o '\0')
+ * @param a primeira string
+ * @param b segunda string
+ * @return Um valor negativo se @param{a} é menor, 0 se são iguais, positivo se @param{a} é maior
  */
-int parse_string(Stack *stack, char *string);
+int compare_string_elements(StackElement *a, StackElement *b);
 
 /**
  * @brief Função que compara se duas strings são iguais, caso sejam devolve 1, caso não devolve 0
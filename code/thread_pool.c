@@ -0,0 +1,365 @@
+/**
+ * @file thread_pool.c
+ * @brief Implementação da pool de threads com work-stealing
+ *
+ * Cada thread (a que chama parallel_for é a thread 0) tem uma deque de tarefas. Uma tarefa cobre um intervalo de
+ * partes de um parallel_for: enquanto tiver mais de uma parte, divide-se ao meio e põe a metade de cima na sua
+ * deque, onde pode ser roubada pelas outras threads. A dona tira tarefas do fundo da deque (as mais recentes) e as
+ * outras roubam do topo (as maiores). Quem espera pelo fim de um parallel_for executa tarefas em vez de bloquear,
+ * por isso os parallel_for encaixados dentro de uma tarefa também são divididos pelas threads.
+ * Sem PARALLEL_BLOCKS o parallel_for executa sempre tudo na thread atual.
+ */
+
+#include <stdlib.h>
+#include "thread_pool.h"
+#include "logger.h"
+
+#ifdef PARALLEL_BLOCKS
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "stack.h"
+#include "block_operations.h"
+#include "block_memo.h"
+
+/** Variável de ambiente com o número de threads a usar */
+#define THREAD_POOL_SIZE_VARIABLE "_0M_THREADS"
+
+/** Número máximo de tarefas na deque de cada thread (quando está cheia as partes são executadas logo) */
+#define WORKER_DEQUE_CAPACITY 1024
+
+/**
+ * Tarefas de um parallel_for que ainda não acabaram
+ */
+typedef struct {
+    /** Número de tarefas por acabar (atómico) */
+    int pending;
+} TaskGroup;
+
+/**
+ * Tarefa: as partes [first_part, end_part[ de um parallel_for
+ */
+typedef struct {
+    /** Função a executar em cada parte */
+    ParallelTask task;
+    /** Argumento da função */
+    void *context;
+    /** Número de posições do parallel_for */
+    int count;
+    /** Número de posições de cada parte */
+    int grain;
+    /** Primeira parte */
+    int first_part;
+    /** Parte a seguir à última */
+    int end_part;
+    /** Grupo do parallel_for */
+    TaskGroup *group;
+} PoolTask;
+
+/**
+ * Deque de tarefas de uma thread
+ */
+typedef struct {
+    /** Protege a deque */
+    pthread_mutex_t lock;
+    /** Tarefas, em [top, bottom[ (módulo WORKER_DEQUE_CAPACITY) */
+    PoolTask tasks[WORKER_DEQUE_CAPACITY];
+    /** Posição da tarefa mais antiga (por onde as outras threads roubam) */
+    unsigned long top;
+    /** Posição a seguir à tarefa mais recente (por onde a dona tira) */
+    unsigned long bottom;
+    /** Contadores da thread */
+    WorkerStats stats;
+} WorkerDeque;
+
+/** Número de threads (incluindo a que chama parallel_for), 0 enquanto não for calculado */
+static int pool_size = 0;
+/** Deques das threads (pool_size), NULL enquanto a pool não for criada */
+static WorkerDeque *deques = NULL;
+/** Threads criadas (pool_size - 1) */
+static pthread_t *workers = NULL;
+/** Número de threads criadas */
+static int worker_count = 0;
+
+/** Número de tarefas em todas as deques (atómico) */
+static int queued_tasks = 0;
+/** Número de threads à espera de tarefas (atómico) */
+static int sleeping_workers = 0;
+/** Indica às threads que devem terminar (atómico) */
+static int shutting_down = 0;
+/** Protege a espera das threads sem tarefas */
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+/** Sinalizado quando há tarefas novas ou a pool vai terminar */
+static pthread_cond_t tasks_ready = PTHREAD_COND_INITIALIZER;
+
+/** Deque da thread atual (NULL numa thread fora da pool) */
+static _Thread_local WorkerDeque *current_deque = NULL;
+/** Estado do gerador de números aleatórios usado para escolher a quem roubar */
+static _Thread_local unsigned int steal_seed = 0;
+
+/**
+ * @brief Põe uma tarefa no fundo da deque
+ * @param deque a deque
+ * @param task a tarefa
+ * @return 1 se a tarefa foi posta, 0 se a deque está cheia
+ */
+static int push_task(WorkerDeque *deque, PoolTask *task) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom - deque->top >= WORKER_DEQUE_CAPACITY) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    deque->tasks[deque->bottom++ % WORKER_DEQUE_CAPACITY] = *task;
+
+    pthread_mutex_unlock(&deque->lock);
+
+    __atomic_fetch_add(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sleeping_workers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&sleep_lock);
+        pthread_cond_signal(&tasks_ready);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Tira uma tarefa da deque, do fundo (a dona) ou do topo (as outras threads)
+ * @param deque a deque
+ * @param task para onde a tarefa é copiada
+ * @param from_bottom 1 para tirar do fundo
+ * @return 1 se tirou uma tarefa, 0 se a deque está vazia
+ */
+static int take_task(WorkerDeque *deque, PoolTask *task, int from_bottom) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->top == deque->bottom) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    *task = from_bottom ? deque->tasks[--deque->bottom % WORKER_DEQUE_CAPACITY]
+                        : deque->tasks[deque->top++ % WORKER_DEQUE_CAPACITY];
+
+    pthread_mutex_unlock(&deque->lock);
+
+    __atomic_fetch_sub(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+/**
+ * @brief Procura uma tarefa: primeiro na deque da thread, depois nas outras a começar numa aleatória
+ * @param task para onde a tarefa é copiada
+ * @return 1 se encontrou uma tarefa
+ */
+static int find_task(PoolTask *task) {
+    if (take_task(current_deque, task, 1)) return 1;
+    if (__atomic_load_n(&queued_tasks, __ATOMIC_SEQ_CST) == 0) return 0;
+
+    steal_seed = steal_seed * 1103515245u + 12345u;
+    int first_victim = (int) ((steal_seed >> 16) % (unsigned int) pool_size);
+
+    for (int i = 0; i < pool_size; i++) {
+        WorkerDeque *victim = &deques[(first_victim + i) % pool_size];
+
+        if (victim != current_deque && take_task(victim, task, 0)) {
+            __atomic_fetch_add(&current_deque->stats.steals, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Executa uma tarefa: divide-a enquanto tiver mais de uma parte e depois executa a parte que sobra
+ * @param task a tarefa
+ */
+static void run_task(PoolTask *task) {
+    __atomic_fetch_add(&current_deque->stats.tasks, 1, __ATOMIC_RELAXED);
+
+    while (task->end_part - task->first_part > 1) {
+        PoolTask upper_half = *task;
+        upper_half.first_part = task->first_part + (task->end_part - task->first_part) / 2;
+
+        __atomic_fetch_add(&task->group->pending, 1, __ATOMIC_RELAXED);
+        if (!push_task(current_deque, &upper_half)) {
+            __atomic_fetch_sub(&task->group->pending, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        task->end_part = upper_half.first_part;
+    }
+
+    for (int part = task->first_part; part < task->end_part; part++) {
+        int start = part * task->grain;
+        int end = task->count - start < task->grain ? task->count : start + task->grain;
+
+        task->task(task->context, start, end);
+    }
+
+    __atomic_fetch_sub(&task->group->pending, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ciclo de cada thread da pool: executa tarefas e espera quando não há nenhuma
+ * @param argument a deque da thread
+ * @return NULL
+ */
+static void *run_worker(void *argument) {
+    PoolTask task;
+
+    current_deque = argument;
+    steal_seed = (unsigned int) (current_deque - deques);
+
+    while (!__atomic_load_n(&shutting_down, __ATOMIC_SEQ_CST)) {
+        if (find_task(&task)) {
+            run_task(&task);
+            continue;
+        }
+
+        pthread_mutex_lock(&sleep_lock);
+        __atomic_fetch_add(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&queued_tasks, __ATOMIC_SEQ_CST) == 0
+            && !__atomic_load_n(&shutting_down, __ATOMIC_SEQ_CST)) {
+            pthread_cond_wait(&tasks_ready, &sleep_lock);
+        }
+        __atomic_fetch_sub(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+
+    // A memória temporária de cada thread é libertada antes de ela terminar
+    free_block_arena();
+    free_block_memo();
+    free_stack_pool();
+
+    return NULL;
+}
+
+/**
+ * @brief Cria as deques e as threads da pool, a thread atual fica com a deque 0
+ */
+static void start_workers(void) {
+    int size = get_thread_pool_size();
+
+    deques = calloc((size_t) size, sizeof(WorkerDeque));
+    for (int i = 0; i < size; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+    }
+    current_deque = &deques[0];
+
+    workers = malloc((size_t) (size - 1) * sizeof(pthread_t));
+    for (worker_count = 0; worker_count < size - 1; worker_count++) {
+        if (pthread_create(&workers[worker_count], NULL, run_worker, &deques[worker_count + 1]) != 0) break;
+    }
+}
+
+void parallel_for(int count, int grain, ParallelTask task, void *context) {
+    if (count <= 0) return;
+
+    int part_count = (count + grain - 1) / grain;
+
+    if (part_count == 1 || get_thread_pool_size() <= 1) {
+        for (int start = 0; start < count; start += grain) {
+            task(context, start, count - start < grain ? count : start + grain);
+        }
+        return;
+    }
+
+    if (deques == NULL) start_workers();
+    if (current_deque == NULL) PANIC("parallel_for called from a thread outside the pool")
+
+    TaskGroup group = {1};
+    PoolTask root = {task, context, count, grain, 0, part_count, &group};
+
+    run_task(&root);
+
+    // Enquanto espera, a thread executa as tarefas que restam (deste ou de outros parallel_for)
+    PoolTask next;
+    while (__atomic_load_n(&group.pending, __ATOMIC_ACQUIRE) > 0) {
+        if (find_task(&next)) {
+            run_task(&next);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+int get_thread_pool_size(void) {
+    if (pool_size == 0) {
+        const char *size_variable = getenv(THREAD_POOL_SIZE_VARIABLE);
+        long size = size_variable != NULL ? strtol(size_variable, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+
+        pool_size = size < 1 ? 1 : (int) size;
+    }
+
+    return pool_size;
+}
+
+void set_thread_pool_size(int size) {
+    free_thread_pool();
+    pool_size = size < 1 ? 1 : size;
+}
+
+WorkerStats get_worker_stats(int worker) {
+    WorkerStats stats = {0, 0};
+
+    if (deques != NULL && worker >= 0 && worker < pool_size) {
+        stats.tasks = __atomic_load_n(&deques[worker].stats.tasks, __ATOMIC_RELAXED);
+        stats.steals = __atomic_load_n(&deques[worker].stats.steals, __ATOMIC_RELAXED);
+    }
+
+    return stats;
+}
+
+void free_thread_pool(void) {
+    if (deques == NULL) return;
+
+    pthread_mutex_lock(&sleep_lock);
+    __atomic_store_n(&shutting_down, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&tasks_ready);
+    pthread_mutex_unlock(&sleep_lock);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    for (int i = 0; i < pool_size; i++) {
+        pthread_mutex_destroy(&deques[i].lock);
+    }
+
+    free(workers);
+    free(deques);
+    workers = NULL;
+    deques = NULL;
+    current_deque = NULL;
+    worker_count = 0;
+    shutting_down = 0;
+}
+
+#else
+
+void parallel_for(int count, int grain, ParallelTask task, void *context) {
+    for (int start = 0; start < count; start += grain) {
+        task(context, start, count - start < grain ? count : start + grain);
+    }
+}
+
+int get_thread_pool_size(void) {
+    return 1;
+}
+
+void set_thread_pool_size(int size) {
+    (void) size;
+}
+
+WorkerStats get_worker_stats(int worker) {
+    (void) worker;
+
+    WorkerStats stats = {0, 0};
+    return stats;
+}
+
+void free_thread_pool(void) {}
+
+#endif
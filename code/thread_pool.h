@@ -0,0 +1,58 @@
+/**
+ * @file thread_pool.h
+ * @brief Pool de threads (com work-stealing) para executar partes independentes de um trabalho em paralelo
+ */
+
+#pragma once
+
+/**
+ * Tarefa executada por parallel_for sobre uma parte [start, end[
+ */
+typedef void (*ParallelTask)(void *context, int start, int end);
+
+/**
+ * Contadores de uma thread da pool
+ */
+typedef struct {
+    /** Número de tarefas executadas */
+    unsigned long tasks;
+    /** Número de tarefas roubadas às outras threads */
+    unsigned long steals;
+} WorkerStats;
+
+/**
+ * Executa @param{task} sobre as posições [0, count[ divididas em partes de @param{grain} posições, distribuídas
+ * pelas threads da pool (incluindo a thread que chama). A tarefa é chamada uma vez por parte.
+ * Retorna quando todas as partes terminarem; enquanto espera a thread executa outras tarefas.
+ * Pode ser chamada de dentro de uma tarefa: as partes ficam disponíveis para as threads que não têm trabalho.
+ * @param count número de posições
+ * @param grain número de posições de cada parte (as partes começam sempre em múltiplos de grain)
+ * @param task tarefa
+ * @param context argumento da tarefa
+ */
+void parallel_for(int count, int grain, ParallelTask task, void *context);
+
+/**
+ * Retorna o número de threads usadas por parallel_for.
+ * Por omissão é o número de cores, ou o valor da variável de ambiente _0M_THREADS.
+ * @return O número de threads (incluindo a thread que chama parallel_for)
+ */
+int get_thread_pool_size(void);
+
+/**
+ * Altera o número de threads usadas por parallel_for (termina as threads atuais)
+ * @param size número de threads (incluindo a thread que chama parallel_for)
+ */
+void set_thread_pool_size(int size);
+
+/**
+ * Retorna os contadores de uma thread da pool (a thread 0 é a que chama parallel_for)
+ * @param worker índice da thread
+ * @return Os contadores, a zero se a pool ainda não foi criada
+ */
+WorkerStats get_worker_stats(int worker);
+
+/**
+ * Termina as threads da pool
+ */
+void free_thread_pool(void);
@@ -0,0 +1,516 @@
+/**
+ * @file transpiler.c
+ * @brief Transpilador de programas para C: gera um ficheiro C que, compilado e ligado ao runtime, executa o
+ * programa sem o analisar nem despachar instruções.
+ *
+ * Uso: _0M_transpiler [programa [ficheiro.c]] (por omissão lê o programa do stdin e escreve o C no stdout).
+ *
+ * O programa é compilado (e otimizado) pelo compilador e as instruções de cada bloco são escritas como chamadas
+ * diretas às funções do runtime: os números em push_long/push_double/push_char, as strings e blocos em literais
+ * imortais criados no início do programa, as operações nas funções das tabelas de operations_storage.c (ou, para as
+ * operações com templates no JIT, nas versões inline de native_operations.h) e os arrays e blocos literais em funções
+ * static. As funções dos blocos são registadas no início do main gerado (ver
+ * register_native_block), por isso ~, map, filter, fold, etc. também executam o código C.
+ * O executável gerado lê o input do programa (l, t) a partir da primeira linha do stdin.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+#include "compiler.h"
+#include "operations_storage.h"
+#include "operations.h"
+#include "polymorphic_operations.h"
+#include "logger.h"
+
+/** Tamanho do buffer de input */
+#define INPUT_BUFFER_SIZE 10001
+/** Capacidade inicial de um buffer de texto */
+#define INITIAL_TEXT_BUFFER_CAPACITY 256
+/** Capacidade inicial da lista de blocos transpilados */
+#define INITIAL_BLOCK_LIST_CAPACITY 8
+
+/**
+ * @brief Buffer de texto com implementação de array dinâmica
+ */
+typedef struct {
+    /** @brief Texto (terminado em '\0') */
+    char *text;
+    /** @brief Tamanho do texto */
+    size_t length;
+    /** @brief Capacidade atual do buffer */
+    size_t capacity;
+} TextBuffer;
+
+/**
+ * @brief Código C de uma função a ser gerada
+ */
+typedef struct {
+    /** @brief Instruções da função */
+    TextBuffer body;
+    /** @brief 1 se a função usa a stack */
+    int uses_stack;
+    /** @brief 1 se a função usa as variáveis */
+    int uses_variables;
+} FunctionCode;
+
+/**
+ * @brief Estado do transpilador
+ */
+typedef struct {
+    /** @brief Declarações dos literais e protótipos das funções */
+    TextBuffer declarations;
+    /** @brief Definições das funções */
+    TextBuffer functions;
+    /** @brief Criação dos literais e registo das funções dos blocos (início do main) */
+    TextBuffer initialization;
+    /** @brief Libertação dos literais (fim do main) */
+    TextBuffer finalization;
+    /** @brief Textos dos blocos literais (o bloco i é transpilado para a função block_i) */
+    char **blocks;
+    /** @brief Número de blocos literais */
+    int block_count;
+    /** @brief Capacidade da lista de blocos literais */
+    int block_capacity;
+    /** @brief Número de arrays (o array i é transpilado para a função array_i) */
+    int array_count;
+    /** @brief Número de literais imortais */
+    int literal_count;
+} Transpiler;
+
+/**
+ * @brief Cria um buffer de texto vazio
+ * @return O buffer
+ */
+static TextBuffer create_text_buffer(void) {
+    TextBuffer buffer = {malloc(INITIAL_TEXT_BUFFER_CAPACITY), 0, INITIAL_TEXT_BUFFER_CAPACITY};
+    buffer.text[0] = '\0';
+
+    return buffer;
+}
+
+/**
+ * @brief Escreve texto formatado (como printf) no fim de um buffer de texto
+ * @param buffer target
+ * @param format formato
+ * @param ... argumentos do formato
+ */
+static void append(TextBuffer *buffer, const char *format, ...) {
+    va_list arguments;
+
+    va_start(arguments, format);
+    int length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+
+    if (length < 0) PANIC("Couldn't format transpiler output\n")
+
+    size_t required = buffer->length + (size_t) length + 1;
+    if (required > buffer->capacity) {
+        while (buffer->capacity < required) buffer->capacity *= 2;
+        buffer->text = realloc(buffer->text, buffer->capacity);
+    }
+
+    va_start(arguments, format);
+    vsnprintf(buffer->text + buffer->length, buffer->capacity - buffer->length, format, arguments);
+    va_end(arguments);
+
+    buffer->length += (size_t) length;
+}
+
+/**
+ * @brief Escreve um texto como literal de string C (entre aspas e com os caracteres especiais escapados)
+ * @param buffer target
+ * @param text texto
+ */
+static void append_c_string(TextBuffer *buffer, const char *text) {
+    append(buffer, "\"");
+
+    for (const unsigned char *c = (const unsigned char *) text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            append(buffer, "\\%c", *c);
+        } else if (*c == '?') {
+            // Evita trigraphs (ex: ??=)
+            append(buffer, "\\?");
+        } else if (*c >= ' ' && *c <= '~') {
+            append(buffer, "%c", *c);
+        } else {
+            append(buffer, "\\%03o", *c);
+        }
+    }
+
+    append(buffer, "\"");
+}
+
+/**
+ * @brief Escreve um long como expressão C
+ * @param buffer target
+ * @param value valor
+ */
+static void append_long(TextBuffer *buffer, long value) {
+    if (value == LONG_MIN) {
+        // -9223372036854775808L não é um literal válido (o literal é positivo e não cabe num long)
+        append(buffer, "(-%ldL - 1)", LONG_MAX);
+    } else {
+        append(buffer, "%ldL", value);
+    }
+}
+
+/**
+ * @brief Escreve um double como expressão C (em hexadecimal, sem perder precisão)
+ * @param buffer target
+ * @param value valor
+ */
+static void append_double(TextBuffer *buffer, double value) {
+    if (isnan(value)) {
+        append(buffer, signbit(value) ? "-NAN" : "NAN");
+    } else if (isinf(value)) {
+        append(buffer, value < 0 ? "-HUGE_VAL" : "HUGE_VAL");
+    } else {
+        append(buffer, "%a", value);
+    }
+}
+
+/**
+ * @brief Retorna o número da função de um bloco literal, adicionando o bloco à lista de blocos a transpilar (e ao
+ * registo no início do main) se ainda não estiver na lista
+ * @param transpiler transpilador
+ * @param block_value texto do bloco
+ * @return O número da função do bloco
+ */
+static int get_block_function(Transpiler *transpiler, const char *block_value) {
+    for (int i = 0; i < transpiler->block_count; ++i) {
+        if (strcmp(transpiler->blocks[i], block_value) == 0) return i;
+    }
+
+    if (transpiler->block_count == transpiler->block_capacity) {
+        transpiler->block_capacity *= 2;
+        transpiler->blocks = realloc(transpiler->blocks, (unsigned long) transpiler->block_capacity * sizeof(char *));
+    }
+
+    int index = transpiler->block_count++;
+    transpiler->blocks[index] = strdup(block_value);
+
+    append(&transpiler->declarations, "static void block_%d(Stack *stack, StackElement *variables);\n", index);
+
+    append(&transpiler->initialization, "    register_native_block(");
+    append_c_string(&transpiler->initialization, block_value);
+    append(&transpiler->initialization, ", block_%d);\n", index);
+
+    return index;
+}
+
+/**
+ * @brief Cria um literal imortal (string ou bloco) criado no início do programa
+ * @param transpiler transpilador
+ * @param literal literal
+ * @return O número do literal
+ */
+static int create_literal(Transpiler *transpiler, StackElement literal) {
+    int index = transpiler->literal_count++;
+
+    append(&transpiler->declarations, "static StackElement literal_%d;\n", index);
+    append(&transpiler->finalization, "    free_immortal_element(literal_%d);\n", index);
+
+    if (literal.type == STRING_TYPE) {
+        append(&transpiler->initialization, "    literal_%d = make_immortal_element(create_string_element(", index);
+        append_c_string(&transpiler->initialization, get_string_value(&literal));
+    } else {
+        append(&transpiler->initialization, "    literal_%d = make_immortal_element(create_block_element(", index);
+        append_c_string(&transpiler->initialization, literal.content.block_value);
+    }
+    append(&transpiler->initialization, "));\n");
+
+    return index;
+}
+
+/**
+ * @brief Escreve o push de um literal
+ * @param transpiler transpilador
+ * @param function função target
+ * @param literal literal
+ * @param indent indentação
+ */
+static void transpile_literal(Transpiler *transpiler, FunctionCode *function, StackElement literal,
+                              const char *indent) {
+    TextBuffer *body = &function->body;
+
+    switch (literal.type) {
+        case LONG_TYPE:
+            append(body, "%snative_push_long(stack, ", indent);
+            append_long(body, literal.content.long_value);
+            append(body, ");\n");
+            break;
+        case DOUBLE_TYPE:
+            append(body, "%snative_push_double(stack, ", indent);
+            append_double(body, literal.content.double_value);
+            append(body, ");\n");
+            break;
+        case CHAR_TYPE:
+            append(body, "%spush_char(stack, (char) %d);\n", indent, literal.content.char_value);
+            break;
+        case BLOCK_TYPE:
+            get_block_function(transpiler, literal.content.block_value);
+            // fallthrough
+        case STRING_TYPE:
+            append(body, "%spush(stack, duplicate_element(literal_%d));\n", indent,
+                   create_literal(transpiler, literal));
+            break;
+        case ARRAY_TYPE:
+        default:
+            PANIC("Can't transpile literal of type %d\n", literal.type)
+    }
+
+    function->uses_stack = 1;
+}
+
+/**
+ * @brief Retorna o nome da versão inline de uma operação (ver native_operations.h)
+ * @param operation operação
+ * @return O nome, NULL se a operação não tem versão inline
+ */
+static const char *get_native_operation_name(StackOperation operation) {
+    if (operation.type == VARIABLES_OPERATION) {
+        return operation.variables_operation == asterisk_operation ? "native_multiply" : NULL;
+    }
+
+    StackOperationFunction operation_function = operation.operation_function;
+
+    if (operation_function == add_operation) return "native_add";
+    if (operation_function == minus_operation) return "native_subtract";
+    if (operation_function == lesser_than_symbol_operation) return "native_lesser";
+    if (operation_function == bigger_than_symbol_operation) return "native_bigger";
+    if (operation_function == equal_symbol_operation) return "native_equal";
+    if (operation_function == duplicate_operation) return "native_duplicate";
+    if (operation_function == swap_last_two_operation) return "native_swap";
+    if (operation_function == rotate_last_three_operation) return "native_rotate";
+    if (operation_function == pop_operation) return "native_pop";
+
+    return NULL;
+}
+
+/**
+ * @brief Escreve a chamada da função de uma operação
+ * @param function função target
+ * @param operation operação
+ */
+static void transpile_operation(FunctionCode *function, StackOperation operation) {
+    const char *name = get_native_operation_name(operation);
+    if (name == NULL) name = get_operation_name(operation);
+    if (name == NULL) PANIC("Can't transpile operation without name\n")
+
+    switch (operation.type) {
+        case SIMPLE_OPERATION:
+            append(&function->body, "    %s(stack);\n", name);
+            break;
+        case VARIABLES_OPERATION:
+            append(&function->body, "    %s(stack, variables);\n", name);
+            function->uses_variables = 1;
+            break;
+        case NO_OPERATION:
+        default:
+            PANIC("Can't transpile operation of type %d\n", operation.type)
+    }
+
+    function->uses_stack = 1;
+}
+
+/**
+ * @brief Transpila um bloco compilado para uma função static (e os arrays dentro dele para outras funções)
+ * @param transpiler transpilador
+ * @param block bloco compilado
+ * @param name nome da função
+ */
+static void transpile_function(Transpiler *transpiler, CompiledBlock *block, const char *name);
+
+/**
+ * @brief Escreve o código de uma instrução
+ * @param transpiler transpilador
+ * @param function função target
+ * @param instruction instrução
+ */
+static void transpile_instruction(Transpiler *transpiler, FunctionCode *function, const Instruction *instruction) {
+    TextBuffer *body = &function->body;
+    char array_name[32];
+
+    switch (instruction->type) {
+        case PUSH_LITERAL_INSTRUCTION:
+            transpile_literal(transpiler, function, instruction->literal, "    ");
+            break;
+        case PUSH_ARRAY_INSTRUCTION:
+            snprintf(array_name, sizeof array_name, "array_%d", transpiler->array_count++);
+            append(&transpiler->declarations, "static void %s(Stack *stack, StackElement *variables);\n", array_name);
+            transpile_function(transpiler, instruction->array_block, array_name);
+
+            append(body, "    native_push_array(stack, variables, %s);\n", array_name);
+            function->uses_stack = 1;
+            function->uses_variables = 1;
+            break;
+        case PUSH_VARIABLE_INSTRUCTION:
+            append(body, "    push_variable(stack, variables, '%c');\n", instruction->variable);
+            function->uses_stack = 1;
+            function->uses_variables = 1;
+            break;
+        case SET_VARIABLE_INSTRUCTION:
+            append(body, "    set_variable(stack, variables, '%c');\n", instruction->variable);
+            function->uses_stack = 1;
+            function->uses_variables = 1;
+            break;
+        case SIMPLE_OPERATION_INSTRUCTION:
+        case VARIABLES_OPERATION_INSTRUCTION:
+            transpile_operation(function, instruction->operation);
+            break;
+        case PUSH_LITERAL_OPERATION_INSTRUCTION:
+            transpile_literal(transpiler, function, instruction->literal_operation.literal, "    ");
+            transpile_operation(function, instruction->literal_operation.operation);
+            break;
+        case DUPLICATE_OPERATION_INSTRUCTION:
+            append(body, "    native_duplicate(stack);\n");
+            transpile_operation(function, instruction->operation);
+            break;
+        case SELECT_LITERAL_INSTRUCTION:
+            append(body, "    if (native_pop_condition(stack)) {\n");
+            transpile_literal(transpiler, function, instruction->select_literals[0], "        ");
+            append(body, "    } else {\n");
+            transpile_literal(transpiler, function, instruction->select_literals[1], "        ");
+            append(body, "    }\n");
+            break;
+        case UNKNOWN_OPERATION_INSTRUCTION:
+            // O programa interpretado também só aborta quando a instrução é executada
+            append(body, "    PANIC(\"Couldn't find operation_function '%%s'\", ");
+            append_c_string(body, instruction->word);
+            append(body, ")\n");
+            break;
+        case RETURN_INSTRUCTION:
+        default:
+            break;
+    }
+}
+
+static void transpile_function(Transpiler *transpiler, CompiledBlock *block, const char *name) {
+    FunctionCode function = {create_text_buffer(), 0, 0};
+
+    for (int i = 0; i < block->length; ++i) {
+        transpile_instruction(transpiler, &function, &block->instructions[i]);
+    }
+
+    append(&transpiler->functions, "\nstatic void %s(Stack *stack, StackElement *variables) {\n", name);
+    if (!function.uses_stack) append(&transpiler->functions, "    (void) stack;\n");
+    if (!function.uses_variables) append(&transpiler->functions, "    (void) variables;\n");
+    append(&transpiler->functions, "%s}\n", function.body.text);
+
+    free(function.body.text);
+}
+
+/**
+ * @brief Escreve o ficheiro C completo
+ * @param transpiler transpilador (com todas as funções já transpiladas)
+ * @param output ficheiro target
+ */
+static void write_program(const Transpiler *transpiler, FILE *output) {
+    fprintf(output,
+            "/* Gerado por _0M_transpiler, não editar */\n"
+            "\n"
+            "#include <math.h>\n"
+            "#include <stdio.h>\n"
+            "#include <stdlib.h>\n"
+            "#include \"stack.h\"\n"
+            "#include \"operations.h\"\n"
+            "#include \"conversions.h\"\n"
+            "#include \"array_operations.h\"\n"
+            "#include \"logica.h\"\n"
+            "#include \"block_operations.h\"\n"
+            "#include \"polymorphic_operations.h\"\n"
+            "#include \"variable_operations.h\"\n"
+            "#include \"compiler.h\"\n"
+            "#include \"thread_pool.h\"\n"
+            "#include \"block_memo.h\"\n"
+            "#include \"native_operations.h\"\n"
+            "#include \"logger.h\"\n"
+            "\n"
+            "static void program(Stack *stack, StackElement *variables);\n"
+            "%s",
+            transpiler->declarations.text);
+
+    fprintf(output,
+            "%s"
+            "\n"
+            "int main(void) {\n"
+            "%s"
+            "\n"
+            "    Stack *stack = create_stack(10);\n"
+            "    StackElement *variables = create_variable_array();\n"
+            "\n"
+            "    program(stack, variables);\n"
+            "\n"
+            "    dump_stack(stack);\n"
+            "    printf(\"\\n\");\n"
+            "\n"
+            "    free_thread_pool();\n"
+            "    free_stack(stack);\n"
+            "    free(variables);\n"
+            "%s"
+            "    free_compiled_block_cache();\n"
+            "    free_block_arena();\n"
+            "    free_block_memo();\n"
+            "    free_stack_pool();\n"
+            "\n"
+            "    return 0;\n"
+            "}\n",
+            transpiler->functions.text, transpiler->initialization.text, transpiler->finalization.text);
+}
+
+/**
+ * @brief A função main do transpilador
+ * @param argc número de argumentos
+ * @param argv argumentos: ficheiro do programa e ficheiro C a gerar (opcionais)
+ */
+int main(int argc, char **argv) {
+    char input[INPUT_BUFFER_SIZE];
+
+    FILE *program_file = argc > 1 ? fopen(argv[1], "r") : stdin;
+    if (program_file == NULL || fgets(input, sizeof input, program_file) != input) {
+        fprintf(stderr, "Couldn't read the program\n");
+        return EXIT_FAILURE;
+    }
+    if (program_file != stdin) fclose(program_file);
+
+    Transpiler transpiler = {
+            create_text_buffer(), create_text_buffer(), create_text_buffer(), create_text_buffer(),
+            malloc(INITIAL_BLOCK_LIST_CAPACITY * sizeof(char *)), 0, INITIAL_BLOCK_LIST_CAPACITY, 0, 0
+    };
+
+    CompiledBlock *program = compile(input);
+    transpile_function(&transpiler, get_optimized_block(program), "program");
+
+    // A lista de blocos cresce enquanto os blocos são transpilados (blocos dentro de blocos)
+    char block_name[32];
+    for (int i = 0; i < transpiler.block_count; ++i) {
+        snprintf(block_name, sizeof block_name, "block_%d", i);
+        transpile_function(&transpiler, get_optimized_block(get_compiled_block(transpiler.blocks[i])), block_name);
+    }
+
+    FILE *output = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (output == NULL) {
+        fprintf(stderr, "Couldn't open the output file\n");
+        return EXIT_FAILURE;
+    }
+
+    write_program(&transpiler, output);
+    if (output != stdout) fclose(output);
+
+    for (int i = 0; i < transpiler.block_count; ++i) {
+        free(transpiler.blocks[i]);
+    }
+    free(transpiler.blocks);
+    free(transpiler.declarations.text);
+    free(transpiler.functions.text);
+    free(transpiler.initialization.text);
+    free(transpiler.finalization.text);
+
+    free_compiled_block(program);
+    free_compiled_block_cache();
+    free_stack_pool();
+
+    return 0;
+}
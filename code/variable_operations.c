@@ -4,13 +4,18 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 #include "stack.h"
 #include "variable_operations.h"
 
 /** @brief O número de variáveis existentes */
 #define VARIABLE_COUNT 26
 
+/**
+ * Número de alterações de variáveis feitas até agora.
+ * As variáveis só são alteradas por blocos executados sequencialmente, por isso as threads da pool só o leem.
+ */
+static unsigned long variables_version = 0;
+
 /**
  * Retorna o indice da variável para aceder ao array de variáveis globais
  * @param key O caractere da variável (EM UPPER CASE)
@@ -20,12 +25,7 @@ static int get_variable_index(const char key) {
     return key - 'A';
 }
 
-/**
- * Verifica se o caractere é uma chave de variável
- * @param variable caractere
- * @return 1 se é chave, 0 caso contrário
- */
-static int is_variable_key(const char variable) {
+int is_variable_key(const char variable) {
     return variable >= 'A' && variable <= 'Z';
 }
 
@@ -37,6 +37,7 @@ static int is_variable_key(const char variable) {
  */
 void set_variable_element(StackElement *variables, char key, StackElement element) {
     variables[get_variable_index(key)] = element;
+    variables_version++;
 }
 
 /**
@@ -69,27 +70,23 @@ StackElement get_variable_value(StackElement *variables, char key) {
     return variables[get_variable_index(key)];
 }
 
-int parse_push_variable(Stack *stack, StackElement *variables, const char *input) {
-    char variable = input[0];
-    if (!is_variable_key(variable) || strlen(input) != 1) return 0;
+unsigned long get_variables_version(void) {
+    return variables_version;
+}
 
-    StackElement element = get_variable_value(variables, variable);
+void push_variable(Stack *stack, StackElement *variables, char key) {
+    StackElement element = get_variable_value(variables, key);
 
     push(stack, duplicate_element(element));
-    return 1;
 }
 
-int parse_set_variable(Stack *stack, StackElement *variables, const char *input) {
-    if (input[0] != ':') return 0;
-    char variable = input[1];
-
-    if (!is_variable_key(variable)) return 0;
-
+void set_variable(Stack *stack, StackElement *variables, char key) {
     StackElement element = pop(stack);
-    set_variable_element(variables, variable, element);
+
+    free_element(get_variable_value(variables, key));
+    set_variable_element(variables, key, element);
 
     push(stack, duplicate_element(element));
-    return 1;
 }
 
 /**
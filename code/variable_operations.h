@@ -14,19 +14,38 @@
 StackElement *create_variable_array();
 
 /**
- * Tenta executar a operação de fazer push de uma variável global
+ * Verifica se o caractere é uma chave de variável
+ * @param variable caractere
+ * @return 1 se é chave, 0 caso contrário
+ */
+int is_variable_key(char variable);
+
+/**
+ * Get ao valor da variável
+ * @param variables Array das variáveis globais
+ * @param key O caractere da variável (EM UPPER CASE)
+ * @return O valor da variável (continua a pertencer à array de variáveis)
+ */
+StackElement get_variable_value(StackElement *variables, char key);
+
+/**
+ * Retorna o número de alterações de variáveis feitas até agora (muda sempre que alguma variável é alterada)
+ * @return A versão das variáveis
+ */
+unsigned long get_variables_version(void);
+
+/**
+ * Executa a operação de fazer push de uma variável global
  * @param stack A stack onde irá fazer push da variável global
  * @param variables A array de variáveis globais
- * @param input O input onde irá buscar a varíavel pretendida
- * @return 1 se conseguiu executar a operação, 0 caso contrário
+ * @param key O caractere da variável (EM UPPER CASE)
  */
-int parse_push_variable(Stack *stack, StackElement *variables, const char *input);
+void push_variable(Stack *stack, StackElement *variables, char key);
 
 /**
- * Tenta executar a operação de alterar o valor de uma variável global
- * @param stack A stack onde irá fazer push da variável global
+ * Executa a operação de alterar o valor de uma variável global para o elemento do topo da stack
+ * @param stack A stack de onde irá buscar o novo valor da variável global
  * @param variables A array de variáveis globais
- * @param input O input onde irá buscar a varíavel pretendida
- * @return 1 se conseguiu executar a operação, 0 caso contrário
+ * @param key O caractere da variável (EM UPPER CASE)
  */
-int parse_set_variable(Stack *stack, StackElement *variables, const char *input);
+void set_variable(Stack *stack, StackElement *variables, char key);